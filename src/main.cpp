@@ -1,14 +1,882 @@
 #include "turt_engine.h"
 
-int main() {
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+
+static double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// cpu checks of the allocator's bookkeeping, everything below runs on BlockMetadata without a device
+struct AllocatorChecks {
+    uint32_t passed = 0;
+    uint32_t failed = 0;
+
+    void check(bool condition, const char* what) {
+        if (condition) {
+            passed++;
+        } else {
+            failed++;
+            std::cout << "  failed: " << what << std::endl;
+        }
+    }
+};
+
+// live ranges must be aligned, inside the block and never overlap, and the used bytes must add up
+static bool validBlock(const BlockMetadata& block) {
+    std::vector<std::pair<VkDeviceSize, VkDeviceSize>> live;
+    bool aligned = true;
+    VkDeviceSize used = 0;
+    block.forEachAllocation([&](VkDeviceSize offset, VkDeviceSize size, VkDeviceSize alignment) {
+        aligned = aligned && offset % alignment == 0;
+        live.emplace_back(offset, size);
+        used += size;
+    });
+
+    std::sort(live.begin(), live.end());
+    for (size_t i = 0; i < live.size(); i++) {
+        VkDeviceSize end = live[i].first + live[i].second;
+        if (end > block.getSize() || (i + 1 < live.size() && end > live[i + 1].first)) {
+            return false;
+        }
+    }
+    return aligned && used == block.getUsedBytes();
+}
+
+static int testAllocator() {
+    AllocatorChecks checks;
+    VkDeviceSize offset;
+
+    {
+        BlockMetadata block(1024);
+        VkDeviceSize a, b, c;
+        checks.check(block.allocate(256, 1, a) && block.allocate(256, 1, b) && block.allocate(256, 1, c),
+                     "three allocations fit");
+        checks.check(!block.allocate(512, 1, offset), "an allocation larger than what's left fails");
+        checks.check(block.allocate(256, 1, offset) && block.getFreeRangeCount() == 0, "the block fills exactly");
+        block.free(offset);
+
+        block.free(b);
+        checks.check(block.getFreeRangeCount() == 2 && block.getLargestFreeRange() == 256,
+                     "a hole and the tail stay separate");
+        block.free(a);
+        checks.check(block.getFreeRangeCount() == 2 && block.getLargestFreeRange() == 512,
+                     "freeing next to a hole coalesces with it");
+        block.free(c);
+        checks.check(block.isEmpty() && block.getFreeRangeCount() == 1 && block.getLargestFreeRange() == 1024,
+                     "freeing everything coalesces back into one range");
+        checks.check(block.allocate(1024, 1, offset) && offset == 0, "the whole block can be allocated again");
+    }
+
+    {
+        // 65536 stands in for a large buffer-image granularity, linear and optimal resources never share a block
+        // so within one block granularity only ever shows up as alignment
+        BlockMetadata block(1024 * 1024);
+        VkDeviceSize alignments[] = { 1, 4, 16, 256, 65536, 3, 48 };
+        std::vector<VkDeviceSize> offsets;
+        for (int round = 0; round < 4; round++) {
+            for (VkDeviceSize alignment : alignments) {
+                if (block.allocate(100 + alignment, alignment, offset)) {
+                    offsets.push_back(offset);
+                }
+            }
+        }
+        checks.check(offsets.size() == 4 * std::size(alignments), "mixed alignments all fit");
+        checks.check(validBlock(block), "mixed alignments are honoured without overlap");
+
+        BlockMetadata small(256);
+        checks.check(small.allocate(1, 1, offset) && small.allocate(16, 128, offset) && offset == 128,
+                     "alignment padding is skipped");
+        checks.check(small.getFreeRangeCount() == 2, "alignment padding goes back on the free list");
+        small.free(128);
+        small.free(0);
+        checks.check(small.getFreeRangeCount() == 1, "padding coalesces once its neighbours are freed");
+    }
+
+    {
+        // how the geometry pool grows its streams
+        BlockMetadata block(512);
+        VkDeviceSize a, b;
+        checks.check(block.allocate(256, 1, a) && block.allocate(256, 1, b), "the block fills before growing");
+        block.grow(1024);
+        checks.check(block.getSize() == 1024 && block.getFreeRangeCount() == 1 && block.getLargestFreeRange() == 512,
+                     "growing a full block adds one free range at the end");
+        checks.check(block.allocate(512, 1, offset) && offset == 512, "the grown space is allocated after the old end");
+        block.free(offset);
+        block.free(b);
+        block.grow(2048);
+        checks.check(block.getFreeRangeCount() == 1 && block.getLargestFreeRange() == 1792,
+                     "growing extends a free range at the end instead of adding one");
+        checks.check(block.allocate(1792, 1, offset) && offset == 256, "the extended range is allocated in one piece");
+        block.free(offset);
+        block.free(a);
+        checks.check(block.isEmpty() && block.getFreeRangeCount() == 1 && block.getLargestFreeRange() == 2048,
+                     "a grown block coalesces back into one range");
+    }
+
+    {
+        BlockMetadata block(1024);
+        std::vector<VkDeviceSize> offsets(8);
+        for (VkDeviceSize& allocation : offsets) {
+            block.allocate(128, 1, allocation);
+        }
+        checks.check(getFragmentation(block.getLargestFreeRange(), block.getSize() - block.getUsedBytes()) == 0.0f,
+                     "a full block isn't fragmented");
+
+        for (size_t i = 0; i < offsets.size(); i += 2) {
+            block.free(offsets[i]);
+        }
+        checks.check(block.getFreeRangeCount() == 4 && block.getLargestFreeRange() == 128, "every other range freed");
+        checks.check(getFragmentation(block.getLargestFreeRange(), block.getSize() - block.getUsedBytes()) == 0.75f,
+                     "four separate holes are 75% fragmented");
+
+        block.free(offsets[1]);
+        float fragmentation = getFragmentation(block.getLargestFreeRange(), block.getSize() - block.getUsedBytes());
+        checks.check(std::abs(fragmentation - 0.4f) < 1e-6f, "joining the first two holes leaves 40% fragmented");
+    }
+
+    {
+        BlockMetadata first(1024);
+        BlockMetadata second(1024);
+        BlockMetadata sparse(1024);
+        BlockMetadata empty(1024);
+        first.allocate(512, 1, offset);
+        second.allocate(600, 1, offset);
+        VkDeviceSize a, b;
+        sparse.allocate(64, 64, a);
+        sparse.allocate(64, 64, b);
+
+        std::vector<BlockMetadata*> pool = { &first, &second, &sparse, &empty };
+        std::vector<DefragmentationPlanEntry> limited = planDefragmentation(pool, 64);
+        checks.check(limited.size() == 1, "the move budget is respected");
+        for (const DefragmentationPlanEntry& entry : limited) {
+            pool[entry.destinationBlock]->free(entry.destinationOffset);
+        }
+
+        std::vector<DefragmentationPlanEntry> plan = planDefragmentation(pool, 1024);
+        bool fromSparse = true;
+        bool intoOccupied = true;
+        for (const DefragmentationPlanEntry& entry : plan) {
+            fromSparse = fromSparse && entry.sourceBlock == 2;
+            intoOccupied = intoOccupied && (entry.destinationBlock == 0 || entry.destinationBlock == 1);
+            checks.check(entry.destinationOffset % 64 == 0, "moves keep their alignment");
+        }
+        checks.check(plan.size() == 2 && fromSparse, "the emptiest block is the one drained");
+        checks.check(intoOccupied, "nothing moves into the empty block");
+        checks.check(first.getUsedBytes() + second.getUsedBytes() == 512 + 600 + 128, "destinations are allocated");
+
+        // what endDefragmentation does once the copies are done
+        for (const DefragmentationPlanEntry& entry : plan) {
+            pool[entry.sourceBlock]->free(entry.sourceOffset);
+        }
+        checks.check(sparse.isEmpty(), "the drained block ends up empty");
+        checks.check(validBlock(first) && validBlock(second), "destinations don't overlap what was there");
+        checks.check(planDefragmentation({ &first, &empty }, 1024).empty(), "a single occupied block has nowhere to go");
+    }
+
+    {
+        // random churn against the invariants
+        BlockMetadata block(1 << 20);
+        std::mt19937 random(1);
+        std::vector<VkDeviceSize> live;
+        bool valid = true;
+        for (int step = 0; step < 20000; step++) {
+            if (live.empty() || random() % 3 != 0) {
+                VkDeviceSize size = 1 + random() % 4096;
+                VkDeviceSize alignment = VkDeviceSize(1) << (random() % 9);
+                if (block.allocate(size, alignment, offset)) {
+                    live.push_back(offset);
+                }
+            } else {
+                size_t index = random() % live.size();
+                block.free(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            if (step % 1000 == 0) {
+                valid = valid && validBlock(block);
+            }
+        }
+        checks.check(valid, "random allocations stay aligned and disjoint");
+
+        for (VkDeviceSize allocation : live) {
+            block.free(allocation);
+        }
+        checks.check(block.isEmpty() && block.getFreeRangeCount() == 1 && block.getLargestFreeRange() == block.getSize(),
+                     "random churn coalesces back into one range");
+    }
+
+    std::cout << "allocator: " << checks.passed << " checks passed, " << checks.failed << " failed" << std::endl;
+    return checks.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// bakes each obj next to itself and compares how long both forms take to get into memory ready for upload
+static int bakeMeshes(int count, char** paths) {
+    if (count == 0) {
+        std::cerr << "usage: --bake <model.obj>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    JobSystem jobs;
+    jobs.init(JobSystem::getDefaultWorkerCount());
+
+    for (int i = 0; i < count; i++) {
+        const char* sourcePath = paths[i];
+        std::string meshPath = getBakedMeshPath(sourcePath);
+
+        MeshOptimizationStats optimizationStats;
+        bakeMesh(sourcePath, meshPath.c_str(), jobs, &optimizationStats);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        MappedFile source;
+        if (!source.open(sourcePath)) {
+            throw std::runtime_error("failed to open file");
+        }
+        MeshData data;
+        loadObj(source.getData(), source.getSize(), data, jobs);
+        double objTime = millisecondsSince(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        MeshFile meshFile;
+        if (!meshFile.open(meshPath.c_str(), sourcePath)) {
+            throw std::runtime_error("failed to open baked mesh");
+        }
+        const MeshFileHeader& header = meshFile.getHeader();
+        // stands in for the copy into the staging buffer
+        std::vector<char> staging(header.vertexCount * sizeof(Vertex) + header.indexCount * header.indexSize);
+        memcpy(staging.data(), meshFile.getVertices(), header.vertexCount * sizeof(Vertex));
+        memcpy(staging.data() + header.vertexCount * sizeof(Vertex), meshFile.getIndices(), header.indexCount * header.indexSize);
+        double bakedTime = millisecondsSince(start);
+
+        std::cout << sourcePath << " -> " << meshPath << ": " << header.vertexCount << " vertices, " << header.indexCount
+                  << " indices (" << header.indexSize * 8 << " bit), obj " << objTime << " ms, baked " << bakedTime << " ms, acmr "
+                  << optimizationStats.before.acmr << " -> " << optimizationStats.after.acmr << std::endl;
+    }
+
+    jobs.cleanup();
+    return EXIT_SUCCESS;
+}
+
+// compares the memory each vertex layout takes for a mesh and how far the compact layout moves its vertices
+// the fetch estimate assumes every index misses the post-transform cache, so it's an upper bound per draw
+static int compareVertexLayouts(int count, char** paths) {
+    if (count == 0) {
+        std::cerr << "usage: --vertex-layouts <model.obj>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    JobSystem jobs;
+    jobs.init(JobSystem::getDefaultWorkerCount());
+
+    for (int i = 0; i < count; i++) {
+        MappedFile source;
+        if (!source.open(paths[i])) {
+            throw std::runtime_error("failed to open file");
+        }
+        MeshData data;
+        loadObj(source.getData(), source.getSize(), data, jobs);
+
+        uint32_t vertexCount = static_cast<uint32_t>(data.vertices.size());
+        uint64_t indexBytes = static_cast<uint64_t>(getIndexSize(getIndexType(vertexCount))) * data.indices.size();
+        std::cout << paths[i] << ": " << vertexCount << " vertices, " << data.indices.size() << " indices, "
+                  << indexBytes << " index bytes" << std::endl;
+
+        for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++) {
+            uint32_t stride = getVertexStride(static_cast<VertexLayout>(layout));
+            std::cout << "  " << getVertexLayoutName(static_cast<VertexLayout>(layout)) << ": " << stride
+                      << " bytes per vertex, " << static_cast<uint64_t>(stride) * vertexCount << " vertex bytes, "
+                      << static_cast<uint64_t>(stride) * data.indices.size() / 1024 << " KB fetched per draw at most"
+                      << std::endl;
+        }
+
+        VertexQuantization quantization = getVertexQuantization(data.boundsMin, data.boundsMax);
+        std::vector<CompactVertex> compact(vertexCount);
+        compressVertices(data.vertices.data(), vertexCount, quantization, compact.data());
+
+        float positionError = 0.0f;
+        float texCoordError = 0.0f;
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            Vertex decoded = decompressVertex(compact[v], quantization);
+            for (int axis = 0; axis < 3; axis++) {
+                positionError = std::max(positionError, std::abs(decoded.pos[axis] - data.vertices[v].pos[axis]));
+            }
+            for (int axis = 0; axis < 2; axis++) {
+                texCoordError = std::max(texCoordError, std::abs(decoded.texCoord[axis] - data.vertices[v].texCoord[axis]));
+            }
+        }
+        std::cout << "  compact error: " << positionError << " position (" << positionError / quantization.scale * 100.0f
+                  << "% of the mesh), " << texCoordError << " uv" << std::endl;
+    }
+
+    jobs.cleanup();
+    return EXIT_SUCCESS;
+}
+
+// triangles as their vertices, rotated to start at the smallest index so winding is kept, sorted
+static std::vector<std::array<uint32_t, 3>> getTriangleSet(const std::vector<uint32_t>& indices) {
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        size_t first = std::min_element(indices.begin() + i, indices.begin() + i + 3) - (indices.begin() + i);
+        triangles.push_back({ indices[i + first], indices[i + (first + 1) % 3], indices[i + (first + 2) % 3] });
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static void printVertexCacheStats(const char* stage, const VertexCacheStats& stats, double time) {
+    std::cout << "  " << stage << ": acmr " << stats.acmr << ", atvr " << stats.atvr << ", " << time << " ms" << std::endl;
+}
+
+// runs each optimizeMesh pass on its own, reporting the post-transform cache after it and checking nothing but the
+// order changed: the reordering passes must keep the same triangles, the fetch pass the same vertex per index
+static int optimizeMeshes(int count, char** paths) {
+    if (count == 0) {
+        std::cerr << "usage: --optimize-mesh <model.obj>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t cacheSize = 16;
+    JobSystem jobs;
+    jobs.init(JobSystem::getDefaultWorkerCount());
+
+    bool failed = false;
+    for (int i = 0; i < count; i++) {
+        MappedFile source;
+        if (!source.open(paths[i])) {
+            throw std::runtime_error("failed to open file");
+        }
+        MeshData data;
+        loadObj(source.getData(), source.getSize(), data, jobs);
+
+        uint32_t vertexCount = static_cast<uint32_t>(data.vertices.size());
+        std::cout << paths[i] << ": " << vertexCount << " vertices, " << data.indices.size() / 3 << " triangles" << std::endl;
+        printVertexCacheStats("obj order", analyzeVertexCache(data.indices, vertexCount, cacheSize), 0.0);
+
+        std::vector<uint32_t> indices = data.indices;
+        std::vector<uint32_t> clusters;
+        auto start = std::chrono::high_resolution_clock::now();
+        optimizeVertexCache(indices, vertexCount, cacheSize, clusters);
+        printVertexCacheStats("vertex cache", analyzeVertexCache(indices, vertexCount, cacheSize), millisecondsSince(start));
+
+        start = std::chrono::high_resolution_clock::now();
+        optimizeOverdraw(indices, data.vertices, cacheSize, clusters, 1.05f);
+        printVertexCacheStats("overdraw", analyzeVertexCache(indices, vertexCount, cacheSize), millisecondsSince(start));
+
+        bool sameTriangles = getTriangleSet(indices) == getTriangleSet(data.indices);
+
+        std::vector<Vertex> vertices = data.vertices;
+        std::vector<uint32_t> fetchIndices = indices;
+        start = std::chrono::high_resolution_clock::now();
+        optimizeVertexFetch(vertices, fetchIndices);
+        double fetchTime = millisecondsSince(start);
+        printVertexCacheStats("vertex fetch",
+                              analyzeVertexCache(fetchIndices, static_cast<uint32_t>(vertices.size()), cacheSize), fetchTime);
+
+        bool sameVertices = fetchIndices.size() == indices.size();
+        for (size_t index = 0; sameVertices && index < indices.size(); index++) {
+            sameVertices = vertices[fetchIndices[index]] == data.vertices[indices[index]];
+        }
+
+        std::cout << "  " << clusters.size() << " clusters, " << vertexCount - vertices.size() << " unused vertices dropped, "
+                  << (sameTriangles && sameVertices ? "same mesh" : "MISMATCH") << std::endl;
+        failed |= !sameTriangles || !sameVertices;
+    }
+
+    jobs.cleanup();
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static bool sameMesh(const MeshData& a, const MeshData& b) {
+    return a.vertices == b.vertices && a.indices == b.indices;
+}
+
+// checks the parallel obj loader against tinyobjloader at increasing thread counts and reports throughput
+static int benchmarkObjLoading(int count, char** paths) {
+    if (count == 0) {
+        std::cerr << "usage: --obj-benchmark <model.obj>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const int runs = 3;
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (int i = 0; i < count; i++) {
+        MappedFile source;
+        if (!source.open(paths[i])) {
+            throw std::runtime_error("failed to open file");
+        }
+        double megabytes = source.getSize() / (1024.0 * 1024.0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        MeshData reference;
+        loadObjReference(source.getData(), source.getSize(), reference);
+        double referenceTime = millisecondsSince(start);
+
+        std::cout << paths[i] << ": " << reference.vertices.size() << " vertices, " << reference.indices.size()
+                  << " indices" << std::endl;
+        std::cout << "  tinyobjloader: " << referenceTime << " ms, " << megabytes / (referenceTime / 1000.0) << " MB/s" << std::endl;
+
+        for (uint32_t threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+            JobSystem jobs;
+            jobs.init(threads - 1);
+
+            double bestTime = 0.0;
+            for (int run = 0; run < runs; run++) {
+                start = std::chrono::high_resolution_clock::now();
+                MeshData mesh;
+                loadObj(source.getData(), source.getSize(), mesh, jobs);
+                double time = millisecondsSince(start);
+                bestTime = run == 0 ? time : std::min(bestTime, time);
+
+                if (!sameMesh(mesh, reference)) {
+                    std::cerr << "  output differs from tinyobjloader with " << threads << " threads" << std::endl;
+                    jobs.cleanup();
+                    return EXIT_FAILURE;
+                }
+            }
+            jobs.cleanup();
+
+            std::cout << "  " << threads << " threads: " << bestTime << " ms, " << megabytes / (bestTime / 1000.0)
+                      << " MB/s" << std::endl;
+
+            if (threads == maxThreads) {
+                break;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// culls random spheres against a fixed camera with the scalar reference, the simd path and the simd path on every core
+static int benchmarkCulling(int count, char** args) {
+    uint32_t sphereCount = count > 0 ? static_cast<uint32_t>(std::stoul(args[0])) : 1000000;
+    const int runs = 5;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    SphereArrays spheres;
+    spheres.resize(sphereCount);
+    for (uint32_t i = 0; i < sphereCount; i++) {
+        spheres.set(i, glm::vec4(position(random), position(random), position(random), size(random)));
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    Frustum frustum = extractFrustum(proj * view);
+
+    std::vector<uint8_t> visible(sphereCount);
+    std::cout << sphereCount << " spheres, " << getCullingInstructionSet() << std::endl;
+
+    uint32_t referenceCount = 0;
+    double bestTime = 0.0;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        referenceCount = 0;
+        for (uint32_t i = 0; i < sphereCount; i++) {
+            glm::vec4 sphere(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i], spheres.radius[i]);
+            visible[i] = isSphereVisible(frustum, sphere);
+            referenceCount += visible[i];
+        }
+        double time = millisecondsSince(start);
+        bestTime = run == 0 ? time : std::min(bestTime, time);
+    }
+    std::cout << "  reference: " << bestTime << " ms, " << referenceCount << " visible" << std::endl;
+
+    for (uint32_t workers : { 0u, JobSystem::getDefaultWorkerCount() }) {
+        JobSystem jobs;
+        jobs.init(workers);
+
+        CullStats stats;
+        for (int run = 0; run < runs; run++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            stats = cullSpheres(frustum, spheres, visible.data(), jobs);
+            double time = millisecondsSince(start);
+            bestTime = run == 0 ? time : std::min(bestTime, time);
+        }
+        jobs.cleanup();
+
+        std::cout << "  " << workers + 1 << " threads: " << bestTime << " ms, " << sphereCount / (bestTime * 1000.0)
+                  << " M spheres/s, " << stats.visibleCount << " visible, " << stats.culledCount << " culled" << std::endl;
+
+        if (stats.visibleCount != referenceCount) {
+            std::cerr << "  visible count differs from the reference" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // the same spheres through cull.comp's cpu version, as unit spheres moved into place by their models
+    // grouped like instanced draws, each group's visible models have to come out packed in order
+    const uint32_t groupSize = 256;
+    std::vector<CullDraw> draws(sphereCount);
+    std::vector<glm::mat4> models(sphereCount);
+    for (uint32_t i = 0; i < sphereCount; i++) {
+        uint32_t group = i / groupSize;
+        draws[i] = {};
+        draws[i].command.indexCount = 3;
+        draws[i].command.firstInstance = group * groupSize;
+        draws[i].group = group;
+        draws[i].boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, spheres.radius[i]);
+        models[i] = glm::translate(glm::mat4(1.0f), glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]));
+    }
+
+    CullUniforms uniforms{};
+    std::copy(frustum.planes, frustum.planes + 6, uniforms.planes);
+    uniforms.drawCount = sphereCount;
+    uniforms.testFrustum = 1;
+
+    uint32_t groupCount = (sphereCount + groupSize - 1) / groupSize;
+    std::vector<VkDrawIndexedIndirectCommand> commands(groupCount);
+    std::vector<glm::mat4> visibleModels(sphereCount);
+    for (int run = 0; run < runs; run++) {
+        std::fill(commands.begin(), commands.end(), VkDrawIndexedIndirectCommand{});
+        auto start = std::chrono::high_resolution_clock::now();
+        cullDrawsReference(uniforms, draws.data(), models.data(), commands.data(), visibleModels.data());
+        double time = millisecondsSince(start);
+        bestTime = run == 0 ? time : std::min(bestTime, time);
+    }
+
+    uint32_t drawVisibleCount = 0;
+    for (uint32_t group = 0; group < groupCount; group++) {
+        uint32_t packed = group * groupSize;
+        uint32_t groupEnd = std::min(packed + groupSize, sphereCount);
+        for (uint32_t i = group * groupSize; i < groupEnd; i++) {
+            if (!visible[i]) {
+                continue;
+            }
+            if (visibleModels[packed][3] != models[i][3]) {
+                std::cerr << "  draw " << i << " is missing from its group's visible models" << std::endl;
+                return EXIT_FAILURE;
+            }
+            packed++;
+        }
+
+        uint32_t instanceCount = packed - group * groupSize;
+        if (commands[group].instanceCount != instanceCount) {
+            std::cerr << "  group " << group << " has " << commands[group].instanceCount << " instances, cullSpheres found "
+                      << instanceCount << std::endl;
+            return EXIT_FAILURE;
+        }
+        drawVisibleCount += instanceCount;
+    }
+    std::cout << "  draw reference: " << bestTime << " ms, " << drawVisibleCount << " visible in " << groupCount
+              << " groups" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+static void spinObject(glm::mat4& model, double) {
+    model[3][0] += 0.001f;
+}
+
+// the array-of-structs layout the scene replaced, kept to compare against
+struct BenchmarkDrawable {
+    uint32_t mesh;
+    uint32_t texture;
+    glm::mat4 model;
+    void (*update)(BenchmarkDrawable* self, double time);
+};
+
+static void spinBenchmarkDrawable(BenchmarkDrawable* self, double time) {
+    spinObject(self->model, time);
+}
+
+// times the per-frame cpu work over the scene (updates, sphere transforms, culling, instance writes)
+// against the same work over an array of structs; run under perf stat -e cache-misses for the miss counts
+static int benchmarkScene(int count, char** args) {
+    uint32_t objectCount = count > 0 ? static_cast<uint32_t>(std::stoul(args[0])) : 100000;
+    const uint32_t meshCount = 16;
+    const uint32_t textureCount = 8;
+    const int frames = 100;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+    std::vector<glm::vec4> meshSpheres(meshCount);
+    for (glm::vec4& sphere : meshSpheres) {
+        sphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    Scene scene;
+    std::vector<BenchmarkDrawable> objects(objectCount);
+    for (uint32_t i = 0; i < objectCount; i++) {
+        uint32_t mesh = random() % meshCount;
+        uint32_t texture = random() % textureCount;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+        // a tenth of the objects animate, the rest sit still
+        bool animated = i % 10 == 0;
+
+        scene.create(mesh, texture, meshSpheres[mesh], model, animated ? spinObject : nullptr);
+        objects[i] = { mesh, texture, model, animated ? spinBenchmarkDrawable : nullptr };
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    Frustum frustum = extractFrustum(proj * view);
+
+    JobSystem jobs;
+    jobs.init(JobSystem::getDefaultWorkerCount());
+
+    SphereArrays spheres;
+    std::vector<uint8_t> visible(objectCount);
+    std::vector<glm::mat4> instances(objectCount);
+    std::cout << objectCount << " objects, " << jobs.getThreadCount() << " threads" << std::endl;
+
+    // the old layout kept objects sorted by texture, so walking it in order matches the scene's draw order
+    std::sort(objects.begin(), objects.end(),
+              [](const BenchmarkDrawable& a, const BenchmarkDrawable& b) { return a.texture < b.texture; });
+
+    auto start = std::chrono::high_resolution_clock::now();
+    uint32_t arrayVisible = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        for (BenchmarkDrawable& object : objects) {
+            if (object.update != nullptr) {
+                object.update(&object, frame / 60.0);
+            }
+        }
+
+        // chunked the same way as Scene::computeWorldSpheres so only the layout differs
+        spheres.resize(objectCount);
+        jobs.parallelFor((objectCount + 4095) / 4096, [&](uint32_t chunk) {
+            uint32_t last = std::min((chunk + 1) * 4096, objectCount);
+            for (uint32_t i = chunk * 4096; i < last; i++) {
+                spheres.set(i, transformSphere(meshSpheres[objects[i].mesh], objects[i].model));
+            }
+        });
+        arrayVisible = cullSpheres(frustum, spheres, visible.data(), jobs).visibleCount;
+
+        uint32_t drawIndex = 0;
+        for (uint32_t i = 0; i < objectCount; i++) {
+            if (visible[i]) {
+                instances[drawIndex++] = objects[i].model;
+            }
+        }
+    }
+    double arrayTime = millisecondsSince(start) / frames;
+    std::cout << "  array of structs: " << arrayTime << " ms per frame, " << arrayVisible << " visible" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    uint32_t sceneVisible = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        scene.update(frame / 60.0);
+
+        scene.computeWorldSpheres(spheres, jobs);
+        sceneVisible = cullSpheres(frustum, spheres, visible.data(), jobs).visibleCount;
+
+        const std::vector<uint32_t>& drawOrder = scene.getDrawOrder();
+        const std::vector<glm::mat4>& models = scene.getModels();
+        uint32_t drawIndex = 0;
+        for (uint32_t object : drawOrder) {
+            if (visible[object]) {
+                instances[drawIndex++] = models[object];
+            }
+        }
+    }
+    double sceneTime = millisecondsSince(start) / frames;
+    std::cout << "  scene: " << sceneTime << " ms per frame, " << sceneVisible << " visible" << std::endl;
+
+    jobs.cleanup();
+    return EXIT_SUCCESS;
+}
+
+// moves a small share of a deep random hierarchy every frame and times the world transform pass
+// against moving every root, which forces the whole hierarchy to be recomputed
+static int benchmarkTransforms(int count, char** args) {
+    uint32_t nodeCount = count > 0 ? static_cast<uint32_t>(std::stoul(args[0])) : 1000000;
+    const int frames = 20;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+    Scene scene;
+    std::vector<uint32_t> roots;
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(offset(random), offset(random), offset(random)));
+        // one node in a hundred starts a new tree, the rest hang off a recent node
+        uint32_t parent = i % 100 == 0 ? Scene::NO_PARENT : i - 1 - random() % std::min(i, 64u);
+        scene.create(0, 0, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), local, nullptr, parent);
+        if (parent == Scene::NO_PARENT) {
+            roots.push_back(i);
+        }
+    }
+    scene.updateTransforms();
+
+    std::cout << nodeCount << " nodes, " << roots.size() << " roots" << std::endl;
+
+    glm::mat4 moved = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    for (uint32_t movedCount : { nodeCount / 100, nodeCount }) {
+        double totalTime = 0.0;
+        for (int frame = 0; frame < frames; frame++) {
+            if (movedCount == nodeCount) {
+                for (uint32_t root : roots) {
+                    scene.setLocalTransform(root, moved);
+                }
+            } else {
+                for (uint32_t i = 0; i < movedCount; i++) {
+                    scene.setLocalTransform(random() % nodeCount, moved);
+                }
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            scene.updateTransforms();
+            totalTime += millisecondsSince(start);
+        }
+
+        std::cout << "  " << (movedCount == nodeCount ? "every root" : "1% of nodes") << " moving: "
+                  << totalTime / frames << " ms per frame" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// runs each script headlessly, checks its last frame against the golden image next to it and writes the timings to json
+// exits with failure if any image is off by more than its script's tolerance
+static int runBenchmarks(int count, char** args) {
+    bool updateGolden = false;
+    const char* reportPath = "benchmark_results.json";
+    std::vector<const char*> scriptPaths;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(args[i], "--update-golden") == 0) {
+            updateGolden = true;
+        } else if (strcmp(args[i], "--json") == 0 && i + 1 < count) {
+            reportPath = args[++i];
+        } else {
+            scriptPaths.push_back(args[i]);
+        }
+    }
+
+    if (scriptPaths.empty()) {
+        std::cerr << "usage: --benchmark [--update-golden] [--json <report.json>] <script.txt>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    static const char* goldenNames[] = { "matches golden image", "differs from golden image", "has no golden image",
+                                         "updated golden image" };
+
+    std::vector<BenchmarkReport> reports;
+    bool failed = false;
+    for (const char* path : scriptPaths) {
+        BenchmarkScript script = loadBenchmarkScript(path);
+
+        BenchmarkResult result;
+        VulkanEngine engine{};
+        engine.runBenchmark(script, result);
+
+        BenchmarkReport report = checkBenchmarkResult(script, result, updateGolden);
+        // a script without a golden image can't catch a rendering regression, so that fails too
+        failed |= report.golden == GOLDEN_FAILED || report.golden == GOLDEN_MISSING;
+        reports.push_back(report);
+
+        std::cout << script.name << ": " << report.objectCount << " objects, " << report.frameCount << " frames, "
+                  << report.frameTime.average << " ms average, " << report.frameTime.p99 << " ms p99, loaded in "
+                  << report.loadTime << " ms, " << goldenNames[report.golden];
+        if (report.golden == GOLDEN_FAILED) {
+            std::cout << " (" << report.diff.mismatchedPixels << " pixels off, max error " << report.diff.maxError << ")";
+        } else if (report.golden == GOLDEN_MISSING) {
+            std::cout << " (run with --update-golden to write " << script.goldenPath << ")";
+        }
+        std::cout << std::endl;
+
+        // one secondary command buffer per chunk, each recorded on its own job
+        std::cout << "  recorded on " << report.recordChunks.size() << " threads:";
+        for (size_t i = 0; i < report.recordChunks.size(); i++) {
+            std::cout << (i == 0 ? " " : ", ") << report.recordChunks[i].itemCount << " draws in "
+                      << report.recordChunks[i].recordTime << " ms";
+        }
+        std::cout << std::endl;
+    }
+
+    writeBenchmarkReports(reportPath, reports);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int runMode(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--allocator-test") == 0) {
+        return testAllocator();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bake") == 0) {
+        return bakeMeshes(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--vertex-layouts") == 0) {
+        return compareVertexLayouts(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--optimize-mesh") == 0) {
+        return optimizeMeshes(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--obj-benchmark") == 0) {
+        return benchmarkObjLoading(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--cull-benchmark") == 0) {
+        return benchmarkCulling(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--scene-benchmark") == 0) {
+        return benchmarkScene(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--transform-benchmark") == 0) {
+        return benchmarkTransforms(argc - 2, argv + 2);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--uniform-benchmark") == 0) {
+        VulkanEngine engine{};
+        engine.runUniformBenchmark({ 10, 1000, 100000 });
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--resize-benchmark") == 0) {
+        VulkanEngine engine{};
+        engine.runResizeBenchmark(argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 200);
+        return EXIT_SUCCESS;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        return runBenchmarks(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0) {
+        HeadlessOptions options;
+        if (argc > 2) {
+            options.frameCount = static_cast<uint32_t>(std::stoul(argv[2]));
+        }
+        if (argc > 3) {
+            options.imagePath = argv[3];
+        }
+        if (argc > 4) {
+            options.profilePath = argv[4];
+        }
+        VulkanEngine engine{};
+        engine.runHeadless(options);
+        return EXIT_SUCCESS;
+    }
+
     VulkanEngine engine{};
+    engine.run();
+    return EXIT_SUCCESS;
+}
 
+int main(int argc, char** argv) {
     try {
-        engine.run();
+        // --trace <trace.json> ahead of the other arguments records cpu zones over whatever they run
+        if (argc > 2 && strcmp(argv[1], "--trace") == 0) {
+            const char* tracePath = argv[2];
+            argv[2] = argv[0];
+#if !defined(TURT_TRACE)
+            std::cerr << "built without TURT_TRACE, the trace will be empty" << std::endl;
+#endif
+            beginTrace();
+            int result = runMode(argc - 2, argv + 2);
+            endTrace();
+
+            writeTrace(tracePath);
+            printTraceSummary();
+            return result;
+        }
+
+        return runMode(argc, argv);
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
     }
-
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
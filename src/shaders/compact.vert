@@ -0,0 +1,30 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+struct InstanceData {
+    mat4 model;
+};
+
+layout(std430, binding = 2) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
+// unorm positions arrive in [0, 1], each instance's model matrix already carries the mesh's dequantization
+layout(location = 0) in vec3 inPosition;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+    mat4 model = instances[gl_InstanceIndex].model;
+
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
+    // the color every loaded vertex had
+    fragColor = vec3(1.0);
+    fragTexCoord = inTexCoord;
+}
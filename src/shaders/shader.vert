@@ -1,11 +1,18 @@
 #version 450
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
+struct InstanceData {
+    mat4 model;
+};
+
+layout(std430, binding = 2) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+};
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
@@ -14,7 +21,10 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    // the culling pass packs each draw's visible instances from its firstInstance onwards
+    mat4 model = instances[gl_InstanceIndex].model;
+
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
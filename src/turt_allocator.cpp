@@ -0,0 +1,603 @@
+#include "turt_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static uint32_t findMostSignificantBit(uint64_t value) {
+    uint32_t bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+static uint32_t findLeastSignificantBit(uint64_t value) {
+    uint32_t bit = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+BlockMetadata::BlockMetadata(VkDeviceSize size) : size(size) {
+    for (auto& heads : freeHeads) {
+        heads.fill(NONE);
+    }
+
+    uint32_t index = createRange();
+    ranges[index] = { 0, size, 1, NONE, NONE, NONE, NONE, true };
+    insertFree(index);
+    lastRange = index;
+}
+
+void BlockMetadata::mapping(VkDeviceSize rangeSize, uint32_t& fl, uint32_t& sl) {
+    if (rangeSize < (VkDeviceSize(1) << SMALL_LOG2)) {
+        fl = 0;
+        sl = static_cast<uint32_t>(rangeSize >> (SMALL_LOG2 - SL_LOG2));
+    } else {
+        uint32_t log2 = findMostSignificantBit(rangeSize);
+        fl = log2 - SMALL_LOG2 + 1;
+        sl = static_cast<uint32_t>(rangeSize >> (log2 - SL_LOG2)) ^ SL_COUNT;
+    }
+}
+
+VkDeviceSize BlockMetadata::roundUpToBin(VkDeviceSize rangeSize) {
+    // every range stored in the bin of the rounded size is at least rangeSize bytes
+    if (rangeSize < (VkDeviceSize(1) << SMALL_LOG2)) {
+        return rangeSize + (VkDeviceSize(1) << (SMALL_LOG2 - SL_LOG2)) - 1;
+    }
+    return rangeSize + (VkDeviceSize(1) << (findMostSignificantBit(rangeSize) - SL_LOG2)) - 1;
+}
+
+uint32_t BlockMetadata::findFreeRange(VkDeviceSize rangeSize) const {
+    uint32_t fl, sl;
+    mapping(roundUpToBin(rangeSize), fl, sl);
+    if (fl >= FL_COUNT) {
+        return NONE;
+    }
+
+    uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0) {
+        uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0) {
+            return NONE;
+        }
+        fl = findLeastSignificantBit(flMap);
+        slMap = slBitmaps[fl];
+    }
+
+    return freeHeads[fl][findLeastSignificantBit(slMap)];
+}
+
+bool BlockMetadata::fits(uint32_t index, VkDeviceSize allocSize, VkDeviceSize alignment) const {
+    const Range& range = ranges[index];
+    return alignUp(range.offset, alignment) + allocSize <= range.offset + range.size;
+}
+
+bool BlockMetadata::allocate(VkDeviceSize allocSize, VkDeviceSize alignment, VkDeviceSize& offset) {
+    if (allocSize == 0 || allocSize > size - usedBytes) {
+        return false;
+    }
+    alignment = std::max<VkDeviceSize>(alignment, 1);
+
+    uint32_t index = NONE;
+    for (uint32_t candidate = findFreeRange(allocSize); candidate != NONE; candidate = ranges[candidate].nextFree) {
+        if (fits(candidate, allocSize, alignment)) {
+            index = candidate;
+            break;
+        }
+    }
+    if (index == NONE) {
+        // anything this large fits regardless of where alignment lands
+        index = findFreeRange(allocSize + alignment - 1);
+        if (index == NONE) {
+            return false;
+        }
+    }
+
+    removeFree(index);
+
+    VkDeviceSize alignedOffset = alignUp(ranges[index].offset, alignment);
+    VkDeviceSize padding = alignedOffset - ranges[index].offset;
+    if (padding > 0) {
+        uint32_t front = createRange();
+        ranges[front] = { ranges[index].offset, padding, 1, ranges[index].prevPhysical, index, NONE, NONE, true };
+        if (ranges[front].prevPhysical != NONE) {
+            ranges[ranges[front].prevPhysical].nextPhysical = front;
+        }
+        ranges[index].prevPhysical = front;
+        ranges[index].offset = alignedOffset;
+        ranges[index].size -= padding;
+        insertFree(front);
+    }
+
+    if (ranges[index].size > allocSize) {
+        uint32_t back = createRange();
+        ranges[back] = { alignedOffset + allocSize, ranges[index].size - allocSize, 1, index,
+                         ranges[index].nextPhysical, NONE, NONE, true };
+        if (ranges[back].nextPhysical != NONE) {
+            ranges[ranges[back].nextPhysical].prevPhysical = back;
+        }
+        ranges[index].nextPhysical = back;
+        ranges[index].size = allocSize;
+        insertFree(back);
+        if (lastRange == index) {
+            lastRange = back;
+        }
+    }
+
+    ranges[index].free = false;
+    ranges[index].alignment = alignment;
+    allocations[alignedOffset] = index;
+    usedBytes += allocSize;
+
+    offset = alignedOffset;
+    return true;
+}
+
+void BlockMetadata::free(VkDeviceSize offset) {
+    auto it = allocations.find(offset);
+    if (it == allocations.end()) {
+        throw std::runtime_error("attempted to free an unknown sub-allocation");
+    }
+
+    uint32_t index = it->second;
+    allocations.erase(it);
+    usedBytes -= ranges[index].size;
+    ranges[index].free = true;
+
+    uint32_t prev = ranges[index].prevPhysical;
+    if (prev != NONE && ranges[prev].free) {
+        removeFree(prev);
+        ranges[prev].size += ranges[index].size;
+        ranges[prev].nextPhysical = ranges[index].nextPhysical;
+        if (ranges[prev].nextPhysical != NONE) {
+            ranges[ranges[prev].nextPhysical].prevPhysical = prev;
+        }
+        if (lastRange == index) {
+            lastRange = prev;
+        }
+        releaseRange(index);
+        index = prev;
+    }
+
+    uint32_t next = ranges[index].nextPhysical;
+    if (next != NONE && ranges[next].free) {
+        removeFree(next);
+        ranges[index].size += ranges[next].size;
+        ranges[index].nextPhysical = ranges[next].nextPhysical;
+        if (ranges[index].nextPhysical != NONE) {
+            ranges[ranges[index].nextPhysical].prevPhysical = index;
+        }
+        if (lastRange == next) {
+            lastRange = index;
+        }
+        releaseRange(next);
+    }
+
+    insertFree(index);
+}
+
+void BlockMetadata::grow(VkDeviceSize newSize) {
+    if (newSize <= size) {
+        return;
+    }
+
+    // a free range at the end just gets longer, so it still coalesces like one that was always that size
+    if (ranges[lastRange].free) {
+        removeFree(lastRange);
+        ranges[lastRange].size += newSize - size;
+        insertFree(lastRange);
+    } else {
+        uint32_t index = createRange();
+        ranges[index] = { size, newSize - size, 1, lastRange, NONE, NONE, NONE, true };
+        ranges[lastRange].nextPhysical = index;
+        insertFree(index);
+        lastRange = index;
+    }
+
+    size = newSize;
+}
+
+VkDeviceSize BlockMetadata::getLargestFreeRange() const {
+    if (flBitmap == 0) {
+        return 0;
+    }
+
+    uint32_t fl = findMostSignificantBit(flBitmap);
+    uint32_t sl = findMostSignificantBit(slBitmaps[fl]);
+
+    VkDeviceSize largest = 0;
+    for (uint32_t index = freeHeads[fl][sl]; index != NONE; index = ranges[index].nextFree) {
+        largest = std::max(largest, ranges[index].size);
+    }
+    return largest;
+}
+
+uint32_t BlockMetadata::createRange() {
+    if (!unusedRanges.empty()) {
+        uint32_t index = unusedRanges.back();
+        unusedRanges.pop_back();
+        return index;
+    }
+
+    ranges.push_back({});
+    return static_cast<uint32_t>(ranges.size() - 1);
+}
+
+void BlockMetadata::releaseRange(uint32_t index) {
+    unusedRanges.push_back(index);
+}
+
+void BlockMetadata::insertFree(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(ranges[index].size, fl, sl);
+
+    ranges[index].prevFree = NONE;
+    ranges[index].nextFree = freeHeads[fl][sl];
+    if (freeHeads[fl][sl] != NONE) {
+        ranges[freeHeads[fl][sl]].prevFree = index;
+    }
+    freeHeads[fl][sl] = index;
+
+    flBitmap |= 1ull << fl;
+    slBitmaps[fl] |= 1u << sl;
+    freeRangeCount++;
+}
+
+void BlockMetadata::removeFree(uint32_t index) {
+    uint32_t fl, sl;
+    mapping(ranges[index].size, fl, sl);
+
+    if (ranges[index].prevFree != NONE) {
+        ranges[ranges[index].prevFree].nextFree = ranges[index].nextFree;
+    }
+    if (ranges[index].nextFree != NONE) {
+        ranges[ranges[index].nextFree].prevFree = ranges[index].prevFree;
+    }
+
+    if (freeHeads[fl][sl] == index) {
+        freeHeads[fl][sl] = ranges[index].nextFree;
+        if (freeHeads[fl][sl] == NONE) {
+            slBitmaps[fl] &= ~(1u << sl);
+            if (slBitmaps[fl] == 0) {
+                flBitmap &= ~(1ull << fl);
+            }
+        }
+    }
+    freeRangeCount--;
+}
+
+std::vector<DefragmentationPlanEntry> planDefragmentation(const std::vector<BlockMetadata*>& blocks,
+                                                          VkDeviceSize maxBytesToMove) {
+    std::vector<DefragmentationPlanEntry> plan;
+
+    uint32_t source = UINT32_MAX;
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (!blocks[i]->isEmpty() && (source == UINT32_MAX || blocks[i]->getUsedBytes() < blocks[source]->getUsedBytes())) {
+            source = i;
+        }
+    }
+    if (source == UINT32_MAX) {
+        return plan;
+    }
+
+    // moving into an empty block would only trade one block for another
+    VkDeviceSize bytesMoved = 0;
+    blocks[source]->forEachAllocation([&](VkDeviceSize offset, VkDeviceSize allocSize, VkDeviceSize alignment) {
+        if (bytesMoved + allocSize > maxBytesToMove) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < blocks.size(); i++) {
+            VkDeviceSize destinationOffset;
+            if (i != source && !blocks[i]->isEmpty() && blocks[i]->allocate(allocSize, alignment, destinationOffset)) {
+                plan.push_back({ source, offset, i, destinationOffset, allocSize });
+                bytesMoved += allocSize;
+                return;
+            }
+        }
+    });
+
+    return plan;
+}
+
+float getFragmentation(VkDeviceSize largestFreeRange, VkDeviceSize bytesFree) {
+    if (bytesFree == 0) {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(bytesFree);
+}
+
+void MemoryAllocator::init(VkPhysicalDevice physicalDeviceIn, VkDevice deviceIn) {
+    device = deviceIn;
+    vkGetPhysicalDeviceMemoryProperties(physicalDeviceIn, &memoryProperties);
+}
+
+void MemoryAllocator::cleanup() {
+    for (auto& block : blocks) {
+        if (block) {
+            vkFreeMemory(device, block->memory, nullptr);
+        }
+    }
+    blocks.clear();
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type");
+}
+
+Allocation MemoryAllocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, bool dedicated) {
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    Allocation allocation = allocate(memRequirements, properties, true, dedicated, buffer, VK_NULL_HANDLE);
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+
+    return allocation;
+}
+
+Allocation MemoryAllocator::allocateImage(VkImage image, VkMemoryPropertyFlags properties, bool dedicated) {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    Allocation allocation = allocate(memRequirements, properties, false, dedicated, VK_NULL_HANDLE, image);
+    vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+
+    return allocation;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                                     bool linear, bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    VkDeviceSize blockSize = getPreferredBlockSize(memoryType);
+
+    if (dedicated || requirements.size > blockSize / 2) {
+        return allocateDedicated(requirements, memoryType, dedicatedBuffer, dedicatedImage);
+    }
+
+    Allocation allocation{};
+    allocation.size = requirements.size;
+    allocation.memoryType = memoryType;
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        Block* block = blocks[i].get();
+        if (!block || block->memoryType != memoryType || block->linear != linear) {
+            continue;
+        }
+
+        if (block->metadata.allocate(requirements.size, requirements.alignment, allocation.offset)) {
+            allocation.memory = block->memory;
+            allocation.block = i;
+            allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + allocation.offset : nullptr;
+            return allocation;
+        }
+    }
+
+    uint32_t blockIndex = createBlock(memoryType, linear, blockSize);
+    if (blockIndex == Allocation::DEDICATED) {
+        // out of room for another full block, try to fit just this resource
+        return allocateDedicated(requirements, memoryType, dedicatedBuffer, dedicatedImage);
+    }
+
+    Block* block = blocks[blockIndex].get();
+    block->metadata.allocate(requirements.size, requirements.alignment, allocation.offset);
+    allocation.memory = block->memory;
+    allocation.block = blockIndex;
+    allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + allocation.offset : nullptr;
+
+    return allocation;
+}
+
+Allocation MemoryAllocator::allocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryType,
+                                              VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = dedicatedBuffer;
+    dedicatedInfo.image = dedicatedImage;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = &dedicatedInfo;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    Allocation allocation{};
+    allocation.size = requirements.size;
+    allocation.memoryType = memoryType;
+    allocation.block = Allocation::DEDICATED;
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory");
+    }
+
+    if (isHostVisible(memoryType)) {
+        vkMapMemory(device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped);
+    }
+
+    dedicatedAllocationCount++;
+    dedicatedBytes += requirements.size;
+    dedicatedHeapBytes[getHeapIndex(memoryType)] += requirements.size;
+
+    return allocation;
+}
+
+uint32_t MemoryAllocator::createBlock(uint32_t memoryType, bool linear, VkDeviceSize blockSize) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = blockSize;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        return Allocation::DEDICATED;
+    }
+
+    void* mapped = nullptr;
+    if (isHostVisible(memoryType)) {
+        vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    }
+
+    auto block = std::unique_ptr<Block>(new Block{ memory, mapped, memoryType, linear, BlockMetadata(blockSize) });
+
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (!blocks[i]) {
+            blocks[i] = std::move(block);
+            return i;
+        }
+    }
+
+    blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (allocation.block == Allocation::DEDICATED) {
+        vkFreeMemory(device, allocation.memory, nullptr);
+        dedicatedAllocationCount--;
+        dedicatedBytes -= allocation.size;
+        dedicatedHeapBytes[getHeapIndex(allocation.memoryType)] -= allocation.size;
+    } else {
+        blocks[allocation.block]->metadata.free(allocation.offset);
+        releaseBlockIfUnneeded(allocation.block);
+    }
+
+    allocation = {};
+}
+
+void MemoryAllocator::releaseBlockIfUnneeded(uint32_t blockIndex) {
+    Block* block = blocks[blockIndex].get();
+    if (!block->metadata.isEmpty()) {
+        return;
+    }
+
+    // keep one empty block around per pool so alternating allocate/free doesn't thrash the driver
+    for (uint32_t i = 0; i < blocks.size(); i++) {
+        if (i != blockIndex && blocks[i] && blocks[i]->memoryType == block->memoryType &&
+            blocks[i]->linear == block->linear) {
+            vkFreeMemory(device, block->memory, nullptr);
+            blocks[blockIndex].reset();
+            return;
+        }
+    }
+}
+
+VkDeviceSize MemoryAllocator::getPreferredBlockSize(uint32_t memoryType) const {
+    VkDeviceSize heapSize = memoryProperties.memoryHeaps[getHeapIndex(memoryType)].size;
+    return heapSize <= 1024ull * 1024 * 1024 ? heapSize / 8 : DEFAULT_BLOCK_SIZE;
+}
+
+bool MemoryAllocator::isHostVisible(uint32_t memoryType) const {
+    return (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+MemoryStats MemoryAllocator::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    MemoryStats stats{};
+    stats.dedicatedAllocationCount = dedicatedAllocationCount;
+    stats.allocationCount = dedicatedAllocationCount;
+    stats.bytesAllocated = dedicatedBytes;
+    stats.bytesUsed = dedicatedBytes;
+    stats.heapBytesAllocated = dedicatedHeapBytes;
+
+    for (const auto& block : blocks) {
+        if (!block) {
+            continue;
+        }
+
+        stats.blockCount++;
+        stats.allocationCount += block->metadata.getAllocationCount();
+        stats.freeRangeCount += block->metadata.getFreeRangeCount();
+        stats.bytesAllocated += block->metadata.getSize();
+        stats.heapBytesAllocated[getHeapIndex(block->memoryType)] += block->metadata.getSize();
+        stats.bytesUsed += block->metadata.getUsedBytes();
+        stats.bytesFree += block->metadata.getSize() - block->metadata.getUsedBytes();
+        stats.largestFreeRange = std::max(stats.largestFreeRange, block->metadata.getLargestFreeRange());
+    }
+
+    stats.fragmentation = getFragmentation(stats.largestFreeRange, stats.bytesFree);
+
+    return stats;
+}
+
+std::vector<DefragmentationMove> MemoryAllocator::beginDefragmentation(VkDeviceSize maxBytesToMove) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<DefragmentationMove> moves;
+    VkDeviceSize bytesMoved = 0;
+    std::vector<bool> planned(blocks.size(), false);
+
+    // drain the emptiest block of each pool into its siblings so it can be released afterwards
+    for (uint32_t first = 0; first < blocks.size(); first++) {
+        if (!blocks[first] || planned[first]) {
+            continue;
+        }
+
+        std::vector<uint32_t> pool;
+        std::vector<BlockMetadata*> metadata;
+        for (uint32_t i = first; i < blocks.size(); i++) {
+            if (blocks[i] && blocks[i]->memoryType == blocks[first]->memoryType && blocks[i]->linear == blocks[first]->linear) {
+                planned[i] = true;
+                pool.push_back(i);
+                metadata.push_back(&blocks[i]->metadata);
+            }
+        }
+
+        for (const DefragmentationPlanEntry& entry : planDefragmentation(metadata, maxBytesToMove - bytesMoved)) {
+            DefragmentationMove move{};
+            move.source = getBlockAllocation(pool[entry.sourceBlock], entry.sourceOffset, entry.size);
+            move.destination = getBlockAllocation(pool[entry.destinationBlock], entry.destinationOffset, entry.size);
+            moves.push_back(move);
+            bytesMoved += entry.size;
+        }
+    }
+
+    return moves;
+}
+
+Allocation MemoryAllocator::getBlockAllocation(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size) const {
+    const Block* block = blocks[blockIndex].get();
+
+    Allocation allocation{};
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.memoryType = block->memoryType;
+    allocation.block = blockIndex;
+    allocation.mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+    return allocation;
+}
+
+void MemoryAllocator::endDefragmentation(const std::vector<DefragmentationMove>& moves) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const DefragmentationMove& move : moves) {
+        blocks[move.source.block]->metadata.free(move.source.offset);
+    }
+
+    for (const DefragmentationMove& move : moves) {
+        if (blocks[move.source.block]) {
+            releaseBlockIfUnneeded(move.source.block);
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// sub-allocation bookkeeping for a single VkDeviceMemory block (two-level segregated fit)
+// this class never touches the device, so it can be exercised entirely on the cpu
+class BlockMetadata {
+public:
+    explicit BlockMetadata(VkDeviceSize size);
+
+    bool allocate(VkDeviceSize allocSize, VkDeviceSize alignment, VkDeviceSize& offset);
+
+    void free(VkDeviceSize offset);
+
+    // adds free space at the end, everything allocated so far keeps its offset
+    void grow(VkDeviceSize newSize);
+
+    VkDeviceSize getSize() const { return size; }
+
+    VkDeviceSize getUsedBytes() const { return usedBytes; }
+
+    uint32_t getAllocationCount() const { return static_cast<uint32_t>(allocations.size()); }
+
+    uint32_t getFreeRangeCount() const { return freeRangeCount; }
+
+    VkDeviceSize getLargestFreeRange() const;
+
+    bool isEmpty() const { return allocations.empty(); }
+
+    template<typename Func>
+    void forEachAllocation(Func func) const {
+        for (const auto& allocation : allocations) {
+            const Range& range = ranges[allocation.second];
+            func(range.offset, range.size, range.alignment);
+        }
+    }
+
+private:
+    static constexpr uint32_t SL_LOG2 = 5;
+    static constexpr uint32_t SL_COUNT = 1 << SL_LOG2;
+    static constexpr uint32_t SMALL_LOG2 = 8;
+    static constexpr uint32_t FL_COUNT = 64 - SMALL_LOG2 + 1;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        VkDeviceSize alignment;
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool free;
+    };
+
+    VkDeviceSize size;
+    VkDeviceSize usedBytes = 0;
+    uint32_t freeRangeCount = 0;
+    // the range ending at size, which grow() extends
+    uint32_t lastRange = NONE;
+
+    std::vector<Range> ranges;
+    std::vector<uint32_t> unusedRanges;
+    std::unordered_map<VkDeviceSize, uint32_t> allocations;
+
+    uint64_t flBitmap = 0;
+    std::array<uint32_t, FL_COUNT> slBitmaps{};
+    std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> freeHeads;
+
+    static void mapping(VkDeviceSize rangeSize, uint32_t& fl, uint32_t& sl);
+
+    static VkDeviceSize roundUpToBin(VkDeviceSize rangeSize);
+
+    uint32_t findFreeRange(VkDeviceSize rangeSize) const;
+
+    uint32_t createRange();
+
+    void releaseRange(uint32_t index);
+
+    void insertFree(uint32_t index);
+
+    void removeFree(uint32_t index);
+
+    bool fits(uint32_t index, VkDeviceSize allocSize, VkDeviceSize alignment) const;
+};
+
+// one allocation to move out of the emptiest block of a pool, indices are into the blocks given to planDefragmentation
+// the destination range has already been allocated
+struct DefragmentationPlanEntry {
+    uint32_t sourceBlock;
+    VkDeviceSize sourceOffset;
+    uint32_t destinationBlock;
+    VkDeviceSize destinationOffset;
+    VkDeviceSize size;
+};
+
+// blocks all belong to one pool, the emptiest one that isn't empty yet is drained into the others that aren't empty
+// only the metadata is touched, so like BlockMetadata this runs entirely on the cpu
+std::vector<DefragmentationPlanEntry> planDefragmentation(const std::vector<BlockMetadata*>& blocks,
+                                                          VkDeviceSize maxBytesToMove);
+
+// 0 when all free space is one contiguous range, approaching 1 as it splinters
+float getFragmentation(VkDeviceSize largestFreeRange, VkDeviceSize bytesFree);
+
+struct Allocation {
+    static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    uint32_t block = DEDICATED;
+};
+
+struct MemoryStats {
+    uint32_t blockCount = 0;
+    uint32_t dedicatedAllocationCount = 0;
+    uint32_t allocationCount = 0;
+    uint32_t freeRangeCount = 0;
+    VkDeviceSize bytesAllocated = 0;
+    VkDeviceSize bytesUsed = 0;
+    VkDeviceSize bytesFree = 0;
+    VkDeviceSize largestFreeRange = 0;
+    // see getFragmentation
+    float fragmentation = 0.0f;
+    // blocks and dedicated allocations, indexed like VkPhysicalDeviceMemoryProperties::memoryHeaps
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapBytesAllocated{};
+};
+
+// the caller copies source to destination and rebinds its resource before ending the pass
+struct DefragmentationMove {
+    Allocation source;
+    Allocation destination;
+};
+
+class MemoryAllocator {
+public:
+    void init(VkPhysicalDevice physicalDeviceIn, VkDevice deviceIn);
+
+    void cleanup();
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+    Allocation allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, bool dedicated);
+
+    Allocation allocateImage(VkImage image, VkMemoryPropertyFlags properties, bool dedicated);
+
+    void free(Allocation& allocation);
+
+    MemoryStats getStats() const;
+
+    std::vector<DefragmentationMove> beginDefragmentation(VkDeviceSize maxBytesToMove);
+
+    void endDefragmentation(const std::vector<DefragmentationMove>& moves);
+
+private:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+    struct Block {
+        VkDeviceMemory memory;
+        void* mapped;
+        uint32_t memoryType;
+        bool linear;
+        BlockMetadata metadata;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    uint32_t dedicatedAllocationCount = 0;
+    VkDeviceSize dedicatedBytes = 0;
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> dedicatedHeapBytes{};
+
+    mutable std::mutex mutex;
+
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear,
+                        bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+
+    Allocation allocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryType,
+                                 VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+
+    uint32_t createBlock(uint32_t memoryType, bool linear, VkDeviceSize blockSize);
+
+    void releaseBlockIfUnneeded(uint32_t blockIndex);
+
+    VkDeviceSize getPreferredBlockSize(uint32_t memoryType) const;
+
+    bool isHostVisible(uint32_t memoryType) const;
+
+    uint32_t getHeapIndex(uint32_t memoryType) const { return memoryProperties.memoryTypes[memoryType].heapIndex; }
+
+    Allocation getBlockAllocation(uint32_t blockIndex, VkDeviceSize offset, VkDeviceSize size) const;
+};
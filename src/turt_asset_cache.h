@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 64-bit fnv-1a, used to recognise identical file contents loaded from different paths
+inline uint64_t hashBytes(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+struct CacheStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t evictions = 0;
+    uint32_t liveCount = 0;
+    uint64_t liveBytes = 0;
+    // bytes that would have been loaded and uploaded again without the cache
+    uint64_t bytesSaved = 0;
+};
+
+// reference counted assets looked up by key (usually a path) and optionally by content hash
+// handles stay valid until the last reference is released, at which point the asset is handed back for destruction
+template<typename T>
+class AssetCache {
+public:
+    bool acquire(const std::string& key, uint32_t& handle) {
+        auto it = byKey.find(key);
+        if (it == byKey.end()) {
+            return false;
+        }
+
+        handle = it->second;
+        addReference(handle);
+        return true;
+    }
+
+    // a different key with the same contents shares the asset and becomes an alias for it
+    bool acquireContent(uint64_t hash, const std::string& key, uint32_t& handle) {
+        auto it = byHash.find(hash);
+        if (it == byHash.end()) {
+            return false;
+        }
+
+        handle = it->second;
+        addReference(handle);
+        byKey[key] = handle;
+        entries[handle].keys.push_back(key);
+        return true;
+    }
+
+    uint32_t insert(const std::string& key, T asset, uint64_t bytes) {
+        uint32_t handle = createEntry(std::move(asset), bytes);
+        byKey[key] = handle;
+        entries[handle].keys.push_back(key);
+        return handle;
+    }
+
+    uint32_t insert(const std::string& key, uint64_t hash, T asset, uint64_t bytes) {
+        uint32_t handle = insert(key, std::move(asset), bytes);
+        byHash[hash] = handle;
+        entries[handle].hash = hash;
+        entries[handle].hashed = true;
+        return handle;
+    }
+
+    T& get(uint32_t handle) { return entries[handle].asset; }
+
+    const T& get(uint32_t handle) const { return entries[handle].asset; }
+
+    // returns true and moves the asset out when this was the last reference
+    bool release(uint32_t handle, T& evicted) {
+        Entry& entry = entries[handle];
+        if (--entry.refCount > 0) {
+            return false;
+        }
+
+        for (const std::string& key : entry.keys) {
+            byKey.erase(key);
+        }
+        if (entry.hashed) {
+            byHash.erase(entry.hash);
+        }
+
+        evicted = std::move(entry.asset);
+
+        stats.evictions++;
+        stats.liveCount--;
+        stats.liveBytes -= entry.bytes;
+
+        entry = Entry{};
+        unusedHandles.push_back(handle);
+        return true;
+    }
+
+    template<typename Func>
+    void forEach(Func func) {
+        for (Entry& entry : entries) {
+            if (entry.refCount > 0) {
+                func(entry.asset);
+            }
+        }
+    }
+
+    const CacheStats& getStats() const { return stats; }
+
+private:
+    struct Entry {
+        T asset{};
+        std::vector<std::string> keys;
+        uint64_t hash = 0;
+        bool hashed = false;
+        uint64_t bytes = 0;
+        uint32_t refCount = 0;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint32_t> unusedHandles;
+    std::unordered_map<std::string, uint32_t> byKey;
+    std::unordered_map<uint64_t, uint32_t> byHash;
+
+    CacheStats stats;
+
+    void addReference(uint32_t handle) {
+        entries[handle].refCount++;
+        stats.hits++;
+        stats.bytesSaved += entries[handle].bytes;
+    }
+
+    uint32_t createEntry(T asset, uint64_t bytes) {
+        uint32_t handle;
+        if (!unusedHandles.empty()) {
+            handle = unusedHandles.back();
+            unusedHandles.pop_back();
+        } else {
+            handle = static_cast<uint32_t>(entries.size());
+            entries.emplace_back();
+        }
+
+        Entry& entry = entries[handle];
+        entry.asset = std::move(asset);
+        entry.bytes = bytes;
+        entry.refCount = 1;
+
+        stats.misses++;
+        stats.liveCount++;
+        stats.liveBytes += bytes;
+        return handle;
+    }
+};
@@ -0,0 +1,240 @@
+#include "turt_benchmark.h"
+
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+BenchmarkScript loadBenchmarkScript(const char* path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open benchmark script");
+    }
+
+    BenchmarkScript script;
+    std::string pathString = path;
+    size_t nameStart = pathString.find_last_of("/\\") + 1;
+    size_t extension = pathString.find_last_of('.');
+    if (extension == std::string::npos || extension < nameStart) {
+        extension = pathString.size();
+    }
+    script.name = pathString.substr(nameStart, extension - nameStart);
+    // the golden image sits next to the script
+    script.goldenPath = pathString.substr(0, extension) + ".png";
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string command;
+        if (!(stream >> command) || command[0] == '#') {
+            continue;
+        }
+
+        bool valid = true;
+        if (command == "size") {
+            valid = static_cast<bool>(stream >> script.width >> script.height);
+        } else if (command == "frames") {
+            valid = static_cast<bool>(stream >> script.frameCount);
+        } else if (command == "spacing") {
+            valid = static_cast<bool>(stream >> script.spacing);
+        } else if (command == "tolerance") {
+            valid = static_cast<bool>(stream >> script.channelTolerance >> script.pixelTolerance);
+        } else if (command == "churn") {
+            valid = static_cast<bool>(stream >> script.churnCount);
+        } else if (command == "objects") {
+            BenchmarkObjects objects;
+            valid = static_cast<bool>(stream >> objects.model >> objects.texture >> objects.count);
+            std::string layout;
+            if (valid && stream >> layout) {
+                valid = parseVertexLayout(layout, objects.vertexLayout);
+            }
+            script.objects.push_back(objects);
+        } else if (command == "camera") {
+            CameraKey key;
+            valid = static_cast<bool>(stream >> key.time >> key.position.x >> key.position.y >> key.position.z >>
+                                      key.target.x >> key.target.y >> key.target.z);
+            if (!script.cameraPath.empty() && key.time < script.cameraPath.back().time) {
+                throw std::runtime_error("camera keys out of order in benchmark script");
+            }
+            script.cameraPath.push_back(key);
+        } else {
+            throw std::runtime_error("unknown command in benchmark script");
+        }
+
+        if (!valid) {
+            throw std::runtime_error("malformed line in benchmark script");
+        }
+    }
+
+    if (script.width == 0 || script.height == 0) {
+        throw std::runtime_error("benchmark size must not be zero");
+    }
+
+    return script;
+}
+
+glm::vec3 getBenchmarkObjectPosition(const BenchmarkScript& script, uint32_t index) {
+    uint32_t objectCount = 0;
+    for (const BenchmarkObjects& objects : script.objects) {
+        objectCount += objects.count;
+    }
+
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount))));
+    side = std::max(side, 1u);
+    float offset = (side - 1) * script.spacing * 0.5f;
+    return glm::vec3((index % side) * script.spacing - offset, (index / side) * script.spacing - offset, 0.0f);
+}
+
+void sampleCameraPath(const std::vector<CameraKey>& path, float time, glm::vec3& position, glm::vec3& target) {
+    if (time <= path.front().time) {
+        position = path.front().position;
+        target = path.front().target;
+        return;
+    }
+
+    for (size_t i = 1; i < path.size(); i++) {
+        if (time < path[i].time) {
+            const CameraKey& a = path[i - 1];
+            const CameraKey& b = path[i];
+            float t = (time - a.time) / (b.time - a.time);
+            position = a.position + (b.position - a.position) * t;
+            target = a.target + (b.target - a.target) * t;
+            return;
+        }
+    }
+
+    position = path.back().position;
+    target = path.back().target;
+}
+
+FrameTimeStats computeFrameTimeStats(const std::vector<double>& frameTimes) {
+    FrameTimeStats stats;
+    if (frameTimes.empty()) {
+        return stats;
+    }
+
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) { return sorted[static_cast<size_t>(p * (sorted.size() - 1))]; };
+
+    double total = 0.0;
+    for (double time : sorted) {
+        total += time;
+    }
+
+    stats.average = total / sorted.size();
+    stats.min = sorted.front();
+    stats.p50 = percentile(0.5);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    stats.max = sorted.back();
+    return stats;
+}
+
+ImageDiff compareImages(const BenchmarkScript& script, const uint8_t* image, const uint8_t* golden, uint32_t pixelCount) {
+    ImageDiff diff;
+    for (uint32_t i = 0; i < pixelCount; i++) {
+        uint32_t pixelError = 0;
+        // alpha is always opaque, so only the colour channels count
+        for (uint32_t channel = 0; channel < 3; channel++) {
+            uint32_t error = static_cast<uint32_t>(std::abs(image[i * 4 + channel] - golden[i * 4 + channel]));
+            pixelError = std::max(pixelError, error);
+        }
+
+        diff.maxError = std::max(diff.maxError, pixelError);
+        if (pixelError > script.channelTolerance) {
+            diff.mismatchedPixels++;
+        }
+    }
+
+    diff.passed = diff.mismatchedPixels <= static_cast<uint64_t>(script.pixelTolerance * pixelCount);
+    return diff;
+}
+
+BenchmarkReport checkBenchmarkResult(const BenchmarkScript& script, const BenchmarkResult& result, bool updateGolden) {
+    BenchmarkReport report;
+    report.name = script.name;
+    for (const BenchmarkObjects& objects : script.objects) {
+        report.objectCount += objects.count;
+    }
+    report.frameCount = static_cast<uint32_t>(result.frameTimes.size());
+    report.frameTime = computeFrameTimeStats(result.frameTimes);
+    report.loadTime = result.loadTime;
+    report.uploadBytes = result.uploadStats.totalBytesStaged;
+    report.memoryStats = result.memoryStats;
+    report.gpuStats = result.gpuStats;
+    report.recordChunks = result.recordChunks;
+
+    if (updateGolden) {
+        if (!stbi_write_png(script.goldenPath.c_str(), result.width, result.height, 4, result.image.data(), result.width * 4)) {
+            throw std::runtime_error("failed to write golden image");
+        }
+        report.golden = GOLDEN_UPDATED;
+        return report;
+    }
+
+    int width, height, channels;
+    stbi_uc* golden = stbi_load(script.goldenPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!golden) {
+        report.golden = GOLDEN_MISSING;
+        return report;
+    }
+
+    if (static_cast<uint32_t>(width) == result.width && static_cast<uint32_t>(height) == result.height) {
+        report.diff = compareImages(script, result.image.data(), golden, result.width * result.height);
+    }
+    report.golden = report.diff.passed ? GOLDEN_PASSED : GOLDEN_FAILED;
+    stbi_image_free(golden);
+
+    return report;
+}
+
+void writeBenchmarkReports(const char* path, const std::vector<BenchmarkReport>& reports) {
+    static const char* goldenNames[] = { "passed", "failed", "missing", "updated" };
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open benchmark report");
+    }
+
+    file << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < reports.size(); i++) {
+        const BenchmarkReport& report = reports[i];
+        const FrameTimeStats& time = report.frameTime;
+        file << (i == 0 ? "\n" : ",\n");
+        file << "    {\n";
+        file << "      \"name\": \"" << report.name << "\",\n";
+        file << "      \"objects\": " << report.objectCount << ",\n";
+        file << "      \"frames\": " << report.frameCount << ",\n";
+        file << "      \"frameTimeMs\": { \"average\": " << time.average << ", \"min\": " << time.min
+             << ", \"p50\": " << time.p50 << ", \"p95\": " << time.p95 << ", \"p99\": " << time.p99
+             << ", \"max\": " << time.max << " },\n";
+        file << "      \"loadTimeMs\": " << report.loadTime << ",\n";
+        file << "      \"uploadBytes\": " << report.uploadBytes << ",\n";
+        file << "      \"memory\": { \"bytesAllocated\": " << report.memoryStats.bytesAllocated
+             << ", \"bytesUsed\": " << report.memoryStats.bytesUsed << ", \"blocks\": " << report.memoryStats.blockCount
+             << ", \"dedicatedAllocations\": " << report.memoryStats.dedicatedAllocationCount << " },\n";
+        // averages over the last frames of the run
+        file << "      \"gpuMs\": {";
+        for (size_t j = 0; j < report.gpuStats.size(); j++) {
+            file << (j == 0 ? " " : ", ") << "\"" << report.gpuStats[j].name << "\": " << report.gpuStats[j].average;
+        }
+        file << " },\n";
+        file << "      \"recordChunks\": [";
+        for (size_t j = 0; j < report.recordChunks.size(); j++) {
+            file << (j == 0 ? " " : ", ") << "{ \"draws\": " << report.recordChunks[j].itemCount
+                 << ", \"ms\": " << report.recordChunks[j].recordTime << " }";
+        }
+        file << " ],\n";
+        file << "      \"golden\": \"" << goldenNames[report.golden] << "\",\n";
+        file << "      \"maxError\": " << report.diff.maxError << ",\n";
+        file << "      \"mismatchedPixels\": " << report.diff.mismatchedPixels << "\n";
+        file << "    }";
+    }
+    file << "\n  ]\n}\n";
+}
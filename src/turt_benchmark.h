@@ -0,0 +1,119 @@
+#pragma once
+
+#include "turt_allocator.h"
+#include "turt_gpu_profiler.h"
+#include "turt_mesh.h"
+#include "turt_recorder.h"
+#include "turt_upload.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// where the camera is at a point in time, the path moves linearly between keys
+struct CameraKey {
+    float time;
+    glm::vec3 position;
+    glm::vec3 target;
+};
+
+struct BenchmarkObjects {
+    std::string model;
+    std::string texture;
+    uint32_t count;
+    VertexLayout vertexLayout = VERTEX_LAYOUT_MESH;
+};
+
+// a scene and camera path read from a text file, one command per line:
+//   size <width> <height>
+//   frames <count>
+//   spacing <distance between objects on the grid>
+//   tolerance <max channel difference> <fraction of pixels allowed past it>
+//   objects <model.obj> <texture> <count> [mesh|compact]
+//   churn <drawables destroyed and recreated per frame>
+//   camera <seconds> <x> <y> <z> <target x> <target y> <target z>
+struct BenchmarkScript {
+    std::string name;
+    std::string goldenPath;
+    uint32_t width = 800;
+    uint32_t height = 600;
+    uint32_t frameCount = 300;
+    float spacing = 2.5f;
+    uint32_t channelTolerance = 8;
+    double pixelTolerance = 0.001;
+    uint32_t churnCount = 0;
+    std::vector<BenchmarkObjects> objects;
+    std::vector<CameraKey> cameraPath;
+};
+
+struct FrameTimeStats {
+    // milliseconds
+    double average = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+struct BenchmarkResult {
+    std::vector<double> frameTimes;
+    // milliseconds from loading the first asset until every upload is complete
+    double loadTime = 0.0;
+    UploadStats uploadStats;
+    MemoryStats memoryStats;
+    std::vector<GpuScopeStats> gpuStats;
+    // draws and recording time of each secondary command buffer, averaged over the frames
+    std::vector<RecordChunkStats> recordChunks;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // rgba8 pixels of the last frame
+    std::vector<uint8_t> image;
+};
+
+struct ImageDiff {
+    uint32_t maxError = 0;
+    // pixels with a channel further off than the tolerance
+    uint64_t mismatchedPixels = 0;
+    bool passed = false;
+};
+
+enum GoldenStatus {
+    GOLDEN_PASSED,
+    GOLDEN_FAILED,
+    GOLDEN_MISSING,
+    GOLDEN_UPDATED,
+};
+
+// one script's entry in the json written after a run
+struct BenchmarkReport {
+    std::string name;
+    uint32_t objectCount = 0;
+    uint32_t frameCount = 0;
+    FrameTimeStats frameTime;
+    double loadTime = 0.0;
+    uint64_t uploadBytes = 0;
+    MemoryStats memoryStats;
+    std::vector<GpuScopeStats> gpuStats;
+    std::vector<RecordChunkStats> recordChunks;
+    GoldenStatus golden = GOLDEN_MISSING;
+    ImageDiff diff;
+};
+
+BenchmarkScript loadBenchmarkScript(const char* path);
+
+// objects are laid out on a square grid in the z = 0 plane, in script order
+glm::vec3 getBenchmarkObjectPosition(const BenchmarkScript& script, uint32_t index);
+
+void sampleCameraPath(const std::vector<CameraKey>& path, float time, glm::vec3& position, glm::vec3& target);
+
+FrameTimeStats computeFrameTimeStats(const std::vector<double>& frameTimes);
+
+ImageDiff compareImages(const BenchmarkScript& script, const uint8_t* image, const uint8_t* golden, uint32_t pixelCount);
+
+// compares the rendered image against the script's golden image, or overwrites the golden image with it
+BenchmarkReport checkBenchmarkResult(const BenchmarkScript& script, const BenchmarkResult& result, bool updateGolden);
+
+void writeBenchmarkReports(const char* path, const std::vector<BenchmarkReport>& reports);
@@ -0,0 +1,211 @@
+#include "turt_culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#define TURT_CULL_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TURT_CULL_SSE
+#include <emmintrin.h>
+#endif
+
+Frustum extractFrustum(const glm::mat4& viewProj) {
+    // glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    for (glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+glm::vec4 getBoundingSphere(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    return glm::vec4(center, glm::length(boundsMax - center));
+}
+
+glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& model) {
+    glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+
+    float scale = std::max({ glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                             glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                             glm::dot(glm::vec3(model[2]), glm::vec3(model[2])) });
+
+    return glm::vec4(center, sphere.w * std::sqrt(scale));
+}
+
+bool isSphereVisible(const Frustum& frustum, const glm::vec4& sphere) {
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void cullDrawsReference(const CullUniforms& uniforms, const CullDraw* draws, const glm::mat4* models,
+                        VkDrawIndexedIndirectCommand* commands, glm::mat4* visibleModels) {
+    Frustum frustum;
+    std::copy(uniforms.planes, uniforms.planes + 6, frustum.planes);
+
+    for (uint32_t i = 0; i < uniforms.drawCount; i++) {
+        const CullDraw& draw = draws[i];
+        glm::vec4 sphere = transformSphere(draw.boundingSphere, models[i]);
+        if (uniforms.testFrustum && !isSphereVisible(frustum, sphere)) {
+            continue;
+        }
+
+        // the gpu packs instances in whatever order its atomics land, this keeps draw order
+        VkDrawIndexedIndirectCommand& command = commands[draw.group];
+        uint32_t instanceCount = command.instanceCount;
+        command = draw.command;
+        command.instanceCount = instanceCount + 1;
+        visibleModels[draw.command.firstInstance + instanceCount] = models[i];
+    }
+}
+
+void SphereArrays::resize(size_t count) {
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    radius.resize(count);
+}
+
+const char* getCullingInstructionSet() {
+#if defined(TURT_CULL_AVX)
+    return "avx";
+#elif defined(TURT_CULL_SSE)
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
+
+// written out rather than with glm::dot so every path rounds the same way
+static bool isSphereVisible(const Frustum& frustum, float x, float y, float z, float r) {
+    for (const glm::vec4& plane : frustum.planes) {
+        if (x * plane.x + y * plane.y + z * plane.z + plane.w < -r) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t cullSpheres(const Frustum& frustum, const SphereArrays& spheres, uint32_t first, uint32_t last,
+                     uint8_t* visible) {
+    const float* centerX = spheres.centerX.data();
+    const float* centerY = spheres.centerY.data();
+    const float* centerZ = spheres.centerZ.data();
+    const float* radius = spheres.radius.data();
+
+    uint32_t visibleCount = 0;
+    uint32_t i = first;
+
+#if defined(TURT_CULL_AVX)
+    __m256 planes[6][4];
+    for (int p = 0; p < 6; p++) {
+        for (int c = 0; c < 4; c++) {
+            planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+        }
+    }
+
+    for (; i + 8 <= last; i += 8) {
+        __m256 x = _mm256_loadu_ps(centerX + i);
+        __m256 y = _mm256_loadu_ps(centerY + i);
+        __m256 z = _mm256_loadu_ps(centerZ + i);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, planes[p][0]),
+                                                                        _mm256_mul_ps(y, planes[p][1])),
+                                                          _mm256_mul_ps(z, planes[p][2])),
+                                            planes[p][3]);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; k++) {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += (mask >> k) & 1;
+        }
+    }
+#elif defined(TURT_CULL_SSE)
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; p++) {
+        for (int c = 0; c < 4; c++) {
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+        }
+    }
+
+    // two groups of four per iteration, so both paths walk the spheres eight at a time
+    for (; i + 8 <= last; i += 8) {
+        int mask = 0;
+        for (uint32_t half = 0; half < 8; half += 4) {
+            __m128 x = _mm_loadu_ps(centerX + i + half);
+            __m128 y = _mm_loadu_ps(centerY + i + half);
+            __m128 z = _mm_loadu_ps(centerZ + i + half);
+            __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i + half));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++) {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planes[p][0]),
+                                                                   _mm_mul_ps(y, planes[p][1])),
+                                                        _mm_mul_ps(z, planes[p][2])),
+                                             planes[p][3]);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+
+            mask |= _mm_movemask_ps(inside) << half;
+        }
+
+        for (int k = 0; k < 8; k++) {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += (mask >> k) & 1;
+        }
+    }
+#endif
+
+    for (; i < last; i++) {
+        visible[i] = isSphereVisible(frustum, centerX[i], centerY[i], centerZ[i], radius[i]);
+        visibleCount += visible[i];
+    }
+
+    return visibleCount;
+}
+
+CullStats cullSpheres(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, JobSystem& jobs) {
+    // a multiple of eight keeps every chunk on the simd path until the very last one
+    const uint32_t chunkSize = 16 * 1024;
+
+    uint32_t count = static_cast<uint32_t>(spheres.size());
+    uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    std::vector<uint32_t> chunkVisible(chunkCount);
+    jobs.parallelFor(chunkCount, [&](uint32_t chunk) {
+        uint32_t first = chunk * chunkSize;
+        uint32_t last = std::min(first + chunkSize, count);
+        chunkVisible[chunk] = cullSpheres(frustum, spheres, first, last, visible);
+    });
+
+    CullStats stats;
+    for (uint32_t chunkVisibleCount : chunkVisible) {
+        stats.visibleCount += chunkVisibleCount;
+    }
+    stats.culledCount = count - stats.visibleCount;
+    return stats;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include "turt_jobs.h"
+
+#include <cstdint>
+#include <vector>
+
+// inward facing planes as (normal, distance), normalized so distances are in world units
+// order: left, right, bottom, top, near, far
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// the near plane is clip space z = 0, where vulkan clips
+Frustum extractFrustum(const glm::mat4& viewProj);
+
+// sphere around an axis aligned box as (center, radius)
+glm::vec4 getBoundingSphere(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+// the radius grows with the largest axis scale, so the result stays conservative under non-uniform scale
+glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& model);
+
+bool isSphereVisible(const Frustum& frustum, const glm::vec4& sphere);
+
+// world space spheres with one array per component, so they can be tested several at a time
+struct SphereArrays {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+
+    void resize(size_t count);
+
+    size_t size() const { return radius.size(); }
+
+    void set(size_t index, const glm::vec4& sphere) {
+        centerX[index] = sphere.x;
+        centerY[index] = sphere.y;
+        centerZ[index] = sphere.z;
+        radius[index] = sphere.w;
+    }
+};
+
+struct CullStats {
+    uint32_t visibleCount = 0;
+    uint32_t culledCount = 0;
+};
+
+// "avx", "sse" or "scalar", whichever cullSpheres was compiled for
+const char* getCullingInstructionSet();
+
+// sets visible[i] to 1 for every sphere in [first, last) touching the frustum and to 0 otherwise
+// returns how many were visible
+uint32_t cullSpheres(const Frustum& frustum, const SphereArrays& spheres, uint32_t first, uint32_t last,
+                     uint8_t* visible);
+
+// the same over all spheres, split across the job system
+CullStats cullSpheres(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, JobSystem& jobs);
+
+// one object going into the culling pass, laid out to match cull.comp
+// objects sharing a mesh and texture share one instanced draw, whose instance count the pass adds up
+struct CullDraw {
+    // the group's draw, firstInstance is where its visible instances are packed
+    VkDrawIndexedIndirectCommand command;
+    uint32_t group;
+    uint32_t padding[2];
+    // local space, the model matrix sits at the same index as this draw
+    glm::vec4 boundingSphere;
+};
+
+struct CullUniforms {
+    glm::vec4 planes[6];
+    uint32_t drawCount;
+    // cleared when the draws were already culled on the cpu
+    uint32_t testFrustum;
+};
+
+// cpu version of cull.comp for checking its output, commands must start zeroed like the gpu's
+void cullDrawsReference(const CullUniforms& uniforms, const CullDraw* draws, const glm::mat4* models,
+                        VkDrawIndexedIndirectCommand* commands, glm::mat4* visibleModels);
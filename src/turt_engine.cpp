@@ -4,21 +4,33 @@
 #define GLM_ENABLE_EXPERIMENTAL
 
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/hash.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
 
 #include <stb_image.h>
+#include <stb_image_write.h>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-
-#include <tiny_obj_loader.h>
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+const VkDeviceSize UNIFORM_ARENA_FRAME_SIZE = 64 * 1024;
+
+const VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+
+// starting sizes, the pool doubles whatever runs out
+const uint32_t GEOMETRY_POOL_VERTEX_CAPACITY = 256 * 1024;
+const uint32_t GEOMETRY_POOL_INDEX_CAPACITY = 1024 * 1024;
+
+const uint32_t INITIAL_DRAW_CAPACITY = 1024;
+
+const uint32_t MAX_DESCRIPTOR_SETS = 4096;
+
+const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
 const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation", "VK_LAYER_LUNARG_monitor" };
 
 const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -48,16 +60,6 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
     }
 }
 
-namespace std {
-    template<>
-    struct hash<Vertex> {
-        size_t operator()(Vertex const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                   (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
-
 void VulkanEngine::run() {
     initWindow();
     initVulkan();
@@ -65,6 +67,231 @@ void VulkanEngine::run() {
     cleanup();
 }
 
+void VulkanEngine::runResizeBenchmark(uint32_t resizeCount) {
+    initWindow();
+    initVulkan();
+
+    // alternates between sizes, so every resize changes the extent
+    for (uint32_t i = 0; i < resizeCount && !glfwWindowShouldClose(window); i++) {
+        int width = i % 2 == 0 ? WIDTH + 16 * (i % 32) : WIDTH / 2;
+        int height = i % 2 == 0 ? HEIGHT : HEIGHT / 2 + 8 * (i % 16);
+        glfwSetWindowSize(window, width, height);
+        glfwPollEvents();
+        drawFrame();
+        drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+
+    if (resizeStats.count > 0) {
+        std::cout << resizeStats.count << " resizes: " << resizeStats.totalTime / resizeStats.count << " ms average, "
+                  << resizeStats.maxTime << " ms worst, " << resizeStats.waitTime / resizeStats.count
+                  << " ms of each waiting on the gpu" << std::endl;
+    }
+
+    cleanup();
+}
+
+void VulkanEngine::runUniformBenchmark(const std::vector<uint32_t>& objectCounts) {
+    headless = true;
+    initVulkan();
+
+    // what every object used to carry in its own uniform buffer
+    struct ObjectUniforms {
+        alignas(16) glm::mat4 model;
+        alignas(16) glm::mat4 view;
+        alignas(16) glm::mat4 proj;
+    };
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    for (uint32_t objectCount : objectCounts) {
+        uint32_t frameCount = std::min(std::max(1000000u / objectCount, 10u), 1000u);
+
+        // one buffer per object like before, but objects share memory objects a chunk at a time, since 100k
+        // separate allocations would run past maxMemoryAllocationCount, each object still maps just its own range
+        const uint32_t objectsPerMemory = 1024;
+        std::vector<VkBuffer> buffers(objectCount);
+        std::vector<VkDeviceMemory> memories((objectCount + objectsPerMemory - 1) / objectsPerMemory);
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = sizeof(ObjectUniforms);
+        bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        for (VkBuffer& buffer : buffers) {
+            if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create benchmark uniform buffer");
+            }
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, buffers[0], &requirements);
+        VkDeviceSize stride = (requirements.size + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+
+        for (uint32_t m = 0; m < memories.size(); m++) {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = stride * std::min(objectsPerMemory, objectCount - m * objectsPerMemory);
+            allocInfo.memoryTypeIndex = allocator.findMemoryType(
+                requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &memories[m]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate benchmark uniform memory");
+            }
+        }
+        for (uint32_t i = 0; i < objectCount; i++) {
+            vkBindBufferMemory(device, buffers[i], memories[i / objectsPerMemory], stride * (i % objectsPerMemory));
+        }
+
+        ObjectUniforms uniforms{};
+        uniforms.view = camera.viewMatrix;
+        uniforms.proj = glm::perspective(glm::radians(45.0f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.0f);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t frame = 0; frame < frameCount; frame++) {
+            for (uint32_t i = 0; i < objectCount; i++) {
+                uniforms.model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+
+                void* data;
+                VkDeviceMemory memory = memories[i / objectsPerMemory];
+                vkMapMemory(device, memory, stride * (i % objectsPerMemory), sizeof(uniforms), 0, &data);
+                memcpy(data, &uniforms, sizeof(uniforms));
+                vkUnmapMemory(device, memory);
+            }
+        }
+        double mappedTime =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / frameCount;
+
+        for (VkBuffer buffer : buffers) {
+            vkDestroyBuffer(device, buffer, nullptr);
+        }
+        for (VkDeviceMemory memory : memories) {
+            vkFreeMemory(device, memory, nullptr);
+        }
+
+        FrameArena arena;
+        VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+        VkDeviceSize arenaStride = (sizeof(ObjectUniforms) + alignment - 1) / alignment * alignment;
+        arena.init(device, &allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, alignment, arenaStride * objectCount,
+                   MAX_FRAMES_IN_FLIGHT);
+
+        start = std::chrono::high_resolution_clock::now();
+        for (uint32_t frame = 0; frame < frameCount; frame++) {
+            arena.beginFrame(frame % MAX_FRAMES_IN_FLIGHT);
+            for (uint32_t i = 0; i < objectCount; i++) {
+                uint32_t offset;
+                ObjectUniforms* objectUniforms = arena.allocate<ObjectUniforms>(offset);
+                objectUniforms->model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+                objectUniforms->view = uniforms.view;
+                objectUniforms->proj = uniforms.proj;
+            }
+        }
+        double arenaTime =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / frameCount;
+
+        arena.cleanup();
+
+        std::cout << objectCount << " objects, " << frameCount << " frames: map/memcpy/unmap " << mappedTime
+                  << " ms per frame (" << mappedTime * 1000000.0 / objectCount << " ns per object), arena " << arenaTime
+                  << " ms per frame (" << arenaTime * 1000000.0 / objectCount << " ns per object), "
+                  << mappedTime / arenaTime << "x" << std::endl;
+    }
+
+    cleanup();
+}
+
+void VulkanEngine::runHeadless(const HeadlessOptions& options) {
+    headless = true;
+    headlessOptions = options;
+    initVulkan();
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(options.frameCount);
+    for (uint32_t i = 0; i < options.frameCount; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        drawFrame();
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    vkDeviceWaitIdle(device);
+
+    if (!frameTimes.empty()) {
+        FrameTimeStats stats = computeFrameTimeStats(frameTimes);
+        std::cout << frameTimes.size() << " frames at " << swapchainExtent.width << "x" << swapchainExtent.height << ": "
+                  << stats.average << " ms average, " << 1000.0 / stats.average << " fps" << std::endl;
+        std::cout << "  min " << stats.min << " ms, p50 " << stats.p50 << " ms, p95 " << stats.p95 << " ms, p99 "
+                  << stats.p99 << " ms, max " << stats.max << " ms" << std::endl;
+    }
+
+    for (const GpuScopeStats& scopeStats : gpuProfiler.getStats()) {
+        std::cout << "  gpu " << scopeStats.name << ": " << scopeStats.average << " ms average, " << scopeStats.min
+                  << " ms min, " << scopeStats.max << " ms max" << std::endl;
+    }
+    if (!options.profilePath.empty()) {
+        gpuProfiler.writeCsv(options.profilePath.c_str());
+    }
+
+    if (!options.imagePath.empty()) {
+        saveOffscreenImage(lastImageIndex, options.imagePath.c_str());
+        std::cout << "wrote " << options.imagePath << std::endl;
+    }
+
+    cleanup();
+}
+
+void VulkanEngine::runBenchmark(const BenchmarkScript& script, BenchmarkResult& result) {
+    headless = true;
+    headlessOptions.width = script.width;
+    headlessOptions.height = script.height;
+    benchmarkScript = &script;
+    initVulkan();
+
+    result.loadTime = sceneLoadTime;
+    result.frameTimes.clear();
+    result.frameTimes.reserve(script.frameCount);
+    result.recordChunks.clear();
+    for (uint32_t i = 0; i < script.frameCount; i++) {
+        // the camera path stands in for processInputs, at a fixed 60 frames per second
+        if (!script.cameraPath.empty()) {
+            glm::vec3 target;
+            sampleCameraPath(script.cameraPath, i / 60.0f, camera.pos, target);
+            camera.viewMatrix = glm::lookAt(camera.pos, target, camera.up);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        churnBenchmarkDrawables(script.churnCount);
+        drawFrame();
+        result.frameTimes.push_back(
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+
+        // summed per chunk here, averaged over the frames below
+        const std::vector<RecordChunkStats>& chunkStats = recorder.getChunkStats();
+        if (result.recordChunks.size() < chunkStats.size()) {
+            result.recordChunks.resize(chunkStats.size());
+        }
+        for (size_t chunk = 0; chunk < chunkStats.size(); chunk++) {
+            result.recordChunks[chunk].itemCount += chunkStats[chunk].itemCount;
+            result.recordChunks[chunk].recordTime += chunkStats[chunk].recordTime;
+        }
+    }
+    for (RecordChunkStats& chunk : result.recordChunks) {
+        chunk.itemCount /= std::max(script.frameCount, 1u);
+        chunk.recordTime /= std::max(script.frameCount, 1u);
+    }
+    vkDeviceWaitIdle(device);
+
+    result.uploadStats = uploads.getStats();
+    result.memoryStats = allocator.getStats();
+    result.gpuStats = gpuProfiler.getStats();
+    result.width = swapchainExtent.width;
+    result.height = swapchainExtent.height;
+    readOffscreenImage(lastImageIndex, result.image);
+
+    cleanup();
+    benchmarkScript = nullptr;
+}
+
 void VulkanEngine::initWindow() {
     glfwInit();
 
@@ -134,49 +361,142 @@ void VulkanEngine::processInputs() {
     }
 
     camera.viewMatrix = glm::lookAt(camera.pos, camera.pos + camera.front, camera.up);
-}
 
-void update(Drawable* self) {
-    static double startTime = glfwGetTime();
+    // toggles on the press rather than every frame the key is held
+    bool wireframeKey = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    if (wireframeKey && !wireframeKeyDown && wireframeSupported) {
+        wireframe = !wireframe;
+    }
+    wireframeKeyDown = wireframeKey;
 
-    double currentTime = glfwGetTime();
-    double time = currentTime - startTime;
+    bool overlayKey = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+    if (overlayKey && !overlayKeyDown) {
+        overlay.toggle();
+    }
+    overlayKeyDown = overlayKey;
+}
 
-    self->ubo.model = glm::translate(glm::mat4(1.0f), glm::vec3(cos(time), 0.0f, sin(time)));
+void update(glm::mat4& localTransform, double time) {
+    localTransform = glm::translate(glm::mat4(1.0f), glm::vec3(cos(time), 0.0f, sin(time)));
 }
 
 void VulkanEngine::initVulkan() {
+    jobs.init(JobSystem::getDefaultWorkerCount());
     createInstance();
     setupDebugMessenger();
-    createSurface();
+    if (!headless) {
+        createSurface();
+    }
     pickPhysicalDevice();
     createLogicalDevice();
+    allocator.init(physicalDevice, device);
+    gpuProfiler.init(physicalDevice, device, findQueueFamilies(physicalDevice).graphicsFamily.value(), hostQueryReset,
+                     MAX_FRAMES_IN_FLIGHT);
+    pipelineCache.init(physicalDevice, device, PIPELINE_CACHE_PATH);
+    pipelines.init(device, pipelineCache.get());
     createSwapchain();
     createImageViews();
     createRenderPass();
     createDescriptorSetLayout();
+
+    auto pipelineStart = std::chrono::high_resolution_clock::now();
     createGraphicsPipeline();
+    createCullPipeline();
+    double pipelineTime =
+        std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - pipelineStart).count();
     createCommandPool();
+    createUploadManager();
+    createGeometryPool();
+    createFrameArenas();
     createColorResources();
     createDepthResources();
     createFramebuffers();
     createDescriptorPool();
+    createCullDescriptorSet();
     createCommandBuffers();
     createSyncObjects();
+    if (!headless) {
+        createOverlay();
+    }
 
     camera.pos = glm::vec3(2.0f, 0.0f, 1.0f);
     camera.front = glm::vec3(-1.0f, 0.0f, 0.0f);
     camera.up = glm::vec3(0.0f, 0.0f, 1.0f);
     camera.viewMatrix = glm::lookAt(camera.pos, camera.pos + camera.front, camera.up);
 
-    createDrawable("textures/viking_room.png", "models/viking_room.obj", update);
-    createDrawable("textures/viking_room.png", "models/viking_room.obj", nullptr);
+    loadScene();
+    // loading doesn't count against the animation
+    animationTime = 0.0;
+    animationStartTime = headless ? 0.0 : glfwGetTime();
+
+    const CacheStats& meshStats = meshCache.getStats();
+    const CacheStats& textureStats = textureCache.getStats();
+    std::cout << "asset cache: " << meshStats.liveCount << " meshes, " << textureStats.liveCount << " textures, "
+              << meshStats.hits + textureStats.hits << " hits, " << meshStats.misses + textureStats.misses << " misses, "
+              << meshStats.bytesSaved + textureStats.bytesSaved << " bytes saved" << std::endl;
+    std::cout << "pipeline cache: " << (pipelineCache.isWarm() ? "warm, " : "cold, ") << pipelineCache.getLoadedSize()
+              << " bytes loaded, pipelines created in " << pipelineTime << " ms" << std::endl;
+}
+
+void VulkanEngine::loadScene() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (benchmarkScript == nullptr) {
+        createDrawable("textures/viking_room.png", "models/viking_room.obj", update);
+        createDrawable("textures/viking_room.png", "models/viking_room.obj", nullptr);
+    } else {
+        benchmarkDrawables.clear();
+        nextChurnedDrawable = 0;
+
+        uint32_t index = 0;
+        for (const BenchmarkObjects& objects : benchmarkScript->objects) {
+            for (uint32_t i = 0; i < objects.count; i++) {
+                uint32_t handle = createDrawable(objects.texture.c_str(), objects.model.c_str(), nullptr,
+                                                 Scene::NO_PARENT, objects.vertexLayout);
+                glm::vec3 position = getBenchmarkObjectPosition(*benchmarkScript, index++);
+                scene.setLocalTransform(handle, glm::translate(glm::mat4(1.0f), position));
+                benchmarkDrawables.push_back({ handle, &objects });
+            }
+        }
+
+        // counts the upload itself rather than leaving it to overlap the first frames
+        uploads.wait(uploads.flush());
+    }
+
+    sceneLoadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void VulkanEngine::churnBenchmarkDrawables(uint32_t count) {
+    TURT_TRACE_ZONE("churn drawables");
+    if (benchmarkDrawables.empty()) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        BenchmarkDrawable& drawable = benchmarkDrawables[nextChurnedDrawable];
+        nextChurnedDrawable = (nextChurnedDrawable + 1) % benchmarkDrawables.size();
+
+        // an identity transform under the original lands on the same spot, so the rendered image doesn't change
+        const BenchmarkObjects& objects = *drawable.objects;
+        uint32_t replacement = createDrawable(objects.texture.c_str(), objects.model.c_str(), nullptr, drawable.handle,
+                                              objects.vertexLayout);
+        scene.setLocalTransform(replacement, glm::mat4(1.0f));
+
+        destroyDrawable(drawable.handle);
+        drawable.handle = replacement;
+    }
 }
 
 void VulkanEngine::mainLoop() {
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-        processInputs();
+        {
+            TURT_TRACE_ZONE("poll events");
+            glfwPollEvents();
+        }
+        {
+            TURT_TRACE_ZONE("process inputs");
+            processInputs();
+        }
         drawFrame();
     }
 
@@ -186,57 +506,66 @@ void VulkanEngine::mainLoop() {
 void VulkanEngine::cleanupSwapchain() {
     vkDestroyImageView(device, depthImageView, nullptr);
     vkDestroyImage(device, depthImage, nullptr);
-    vkFreeMemory(device, depthImageMemory, nullptr);
+    allocator.free(depthImageAllocation);
 
     vkDestroyImageView(device, colorImageView, nullptr);
     vkDestroyImage(device, colorImage, nullptr);
-    vkFreeMemory(device, colorImageMemory, nullptr);
+    allocator.free(colorImageAllocation);
 
     for (auto framebuffer : swapchainFramebuffers) {
         vkDestroyFramebuffer(device, framebuffer, nullptr);
     }
 
-    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-
-    vkDestroyRenderPass(device, renderPass, nullptr);
-
     for (auto imageView : swapchainImageViews) {
         vkDestroyImageView(device, imageView, nullptr);
     }
-
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
-
-    for (size_t i = 0; i < swapchainImages.size(); i++) {
-        for (const Drawable& object : objects) {
-            vkDestroyBuffer(device, object.uniformBuffers[i], nullptr);
-            vkFreeMemory(device, object.uniformBuffersMemory[i], nullptr);
-        }
-    }
-
-    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 }
 
 void VulkanEngine::cleanup() {
+    uploads.cleanup();
+    gpuProfiler.cleanup();
+    if (!headless) {
+        overlay.cleanup();
+    }
+
     cleanupSwapchain();
+    vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+    vkDestroyRenderPass(device, renderPass, nullptr);
+    if (headless) {
+        destroyOffscreenImages();
+    } else {
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+    }
 
-    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    for (uint32_t i = 0; i < scene.getCount(); i++) {
+        releaseTexture(scene.getTextures()[i]);
+        releaseMesh(scene.getMeshes()[i]);
+    }
+    scene.clear();
+    frameBatches.clear();
 
-    for (const Drawable& object : objects) {
-        vkDestroySampler(device, object.textureSampler, nullptr);
-        vkDestroyImageView(device, object.textureImageView, nullptr);
+    // the device is idle by now, nothing has to wait for a fence
+    for (size_t i = 0; i < retiredAssets.size(); i++) {
+        destroyRetiredAssets(i, true);
+    }
 
-        vkDestroyImage(device, object.textureImage, nullptr);
-        vkFreeMemory(device, object.textureImageMemory, nullptr);
+    geometry.cleanup();
 
-        vkDestroyBuffer(device, object.indexBuffer, nullptr);
-        vkFreeMemory(device, object.indexBufferMemory, nullptr);
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
 
-        vkDestroyBuffer(device, object.vertexBuffer, nullptr);
-        vkFreeMemory(device, object.vertexBufferMemory, nullptr);
-    }
+    uniformArena.cleanup();
+    instanceArena.cleanup();
+    drawInputArena.cleanup();
+    destroyDrawCommandBuffers();
 
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    pipelines.cleanup();
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+
+    pipelineCache.cleanup();
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
@@ -244,20 +573,28 @@ void VulkanEngine::cleanup() {
         vkDestroyFence(device, inFlightFences[i], nullptr);
     }
 
+    recorder.cleanup();
     vkDestroyCommandPool(device, commandPool, nullptr);
 
+    allocator.cleanup();
+
     vkDestroyDevice(device, nullptr);
 
     if (enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (!headless) {
+        vkDestroySurfaceKHR(instance, surface, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
 
-    glfwDestroyWindow(window);
+    if (!headless) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 
-    glfwTerminate();
+    jobs.cleanup();
 }
 
 void VulkanEngine::recreateSwapchain() {
@@ -268,22 +605,54 @@ void VulkanEngine::recreateSwapchain() {
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(device);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // only the frames in flight and the presentation engine can be using the old attachments
+    // uploads on the transfer queue carry on
+    vkWaitForFences(device, MAX_FRAMES_IN_FLIGHT, inFlightFences.data(), VK_TRUE, UINT64_MAX);
+    vkQueueWaitIdle(presentQueue);
+
+    auto waited = std::chrono::high_resolution_clock::now();
+
+    VkFormat oldFormat = swapchainImageFormat;
+    size_t oldImageCount = swapchainImages.size();
 
     cleanupSwapchain();
 
     createSwapchain();
     createImageViews();
-    createRenderPass();
+
+    // the render pass and everything compiled against it only depend on the formats
+    if (swapchainImageFormat != oldFormat) {
+        // background compiles hold on to the render pass that's about to go
+        pipelines.wait();
+        vkDestroyRenderPass(device, renderPass, nullptr);
+        createRenderPass();
+
+        for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++) {
+            graphicsPipelineKeys[layout].colorFormat = swapchainImageFormat;
+            graphicsPipelines[layout] = pipelines.compile(graphicsPipelineKeys[layout], renderPass);
+        }
+        overlay.setRenderPass(renderPass);
+    }
+
     createColorResources();
     createDepthResources();
     createFramebuffers();
-    createDescriptorPool();
-    for (Drawable& object : objects) {
-        createUniformBuffers(object);
-        createDescriptorSets(object);
+
+    if (swapchainImages.size() != oldImageCount) {
+        vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+        createCommandBuffers();
     }
-    createCommandBuffers();
+    imagesInFlight.assign(swapchainImages.size(), VK_NULL_HANDLE);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double waitTime = std::chrono::duration<double, std::milli>(waited - start).count();
+    double totalTime = std::chrono::duration<double, std::milli>(end - start).count();
+    resizeStats.count++;
+    resizeStats.waitTime += waitTime;
+    resizeStats.totalTime += totalTime;
+    resizeStats.maxTime = std::max(resizeStats.maxTime, totalTime);
 }
 
 void VulkanEngine::createInstance() {
@@ -382,7 +751,8 @@ void VulkanEngine::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(),
+                                               indices.transferFamily.value() };
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -394,8 +764,39 @@ void VulkanEngine::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.fillModeNonSolid = supportedFeatures.fillModeNonSolid;
+    wireframeSupported = supportedFeatures.fillModeNonSolid;
+    // draws find their instance data through firstInstance
+    deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
+    if (supportedFeatures.multiDrawIndirect) {
+        maxDrawIndirectCount = properties.limits.maxDrawIndirectCount;
+    }
+    // one call per draw makes empty draws worth skipping, which takes knowing visibility on the cpu
+    cpuCulling = !supportedFeatures.multiDrawIndirect;
+
+    VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+    supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    if (properties.apiVersion >= VK_API_VERSION_1_2) {
+        VkPhysicalDeviceFeatures2 supportedFeatures2{};
+        supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supportedFeatures2.pNext = &supportedFeatures12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+    }
+
+    VkPhysicalDeviceVulkan12Features deviceFeatures12{};
+    deviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    deviceFeatures12.hostQueryReset = supportedFeatures12.hostQueryReset;
+    hostQueryReset = supportedFeatures12.hostQueryReset;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -404,8 +805,11 @@ void VulkanEngine::createLogicalDevice() {
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
+    if (properties.apiVersion >= VK_API_VERSION_1_2) {
+        createInfo.pNext = &deviceFeatures12;
+    }
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.enabledExtensionCount = headless ? 0 : static_cast<uint32_t>(deviceExtensions.size());
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
     if (enableValidationLayers) {
@@ -421,9 +825,15 @@ void VulkanEngine::createLogicalDevice() {
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
 }
 
 void VulkanEngine::createSwapchain() {
+    if (headless) {
+        createOffscreenImages();
+        return;
+    }
+
     SwapchainSupportDetails swapchainSupport = querySwapchainSupport(physicalDevice);
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapchainSupport.formats);
@@ -461,10 +871,18 @@ void VulkanEngine::createSwapchain() {
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
 
+    // handing over the old swapchain lets the driver reuse its resources
+    VkSwapchainKHR oldSwapchain = swapchain;
+    createInfo.oldSwapchain = oldSwapchain;
+
     if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swapchain");
     }
 
+    if (oldSwapchain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+    }
+
     vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr);
     swapchainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(device, swapchain, &imageCount, swapchainImages.data());
@@ -473,6 +891,104 @@ void VulkanEngine::createSwapchain() {
     swapchainExtent = extent;
 }
 
+void VulkanEngine::createOffscreenImages() {
+    // stands in for the swapchain, in the format the swapchain would most likely have picked
+    swapchainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    swapchainExtent = { headlessOptions.width, headlessOptions.height };
+
+    swapchainImages.resize(MAX_FRAMES_IN_FLIGHT);
+    offscreenImageAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < swapchainImages.size(); i++) {
+        createImage(swapchainExtent.width, swapchainExtent.height, 1, VK_SAMPLE_COUNT_1_BIT, swapchainImageFormat,
+                    VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapchainImages[i], offscreenImageAllocations[i]);
+    }
+}
+
+void VulkanEngine::destroyOffscreenImages() {
+    for (size_t i = 0; i < swapchainImages.size(); i++) {
+        vkDestroyImage(device, swapchainImages[i], nullptr);
+        allocator.free(offscreenImageAllocations[i]);
+    }
+    swapchainImages.clear();
+    offscreenImageAllocations.clear();
+}
+
+void VulkanEngine::saveOffscreenImage(uint32_t imageIndex, const char* path) {
+    std::vector<uint8_t> pixels;
+    readOffscreenImage(imageIndex, pixels);
+
+    if (!stbi_write_png(path, swapchainExtent.width, swapchainExtent.height, 4, pixels.data(), swapchainExtent.width * 4)) {
+        throw std::runtime_error("failed to write image");
+    }
+}
+
+void VulkanEngine::readOffscreenImage(uint32_t imageIndex, std::vector<uint8_t>& pixels) {
+    VkDeviceSize size = static_cast<VkDeviceSize>(swapchainExtent.width) * swapchainExtent.height * 4;
+
+    VkBuffer readbackBuffer;
+    Allocation readbackAllocation;
+    createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 readbackBuffer, readbackAllocation);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate command buffers");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &barrier, 0, nullptr, 0, nullptr);
+
+    // the render pass leaves offscreen images in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { swapchainExtent.width, swapchainExtent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, swapchainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1,
+                           &region);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+                         0, nullptr);
+
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(graphicsQueue);
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+
+    // bgra to rgba
+    pixels.resize(size);
+    memcpy(pixels.data(), readbackAllocation.mapped, size);
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+        std::swap(pixels[i], pixels[i + 2]);
+    }
+
+    vkDestroyBuffer(device, readbackBuffer, nullptr);
+    allocator.free(readbackAllocation);
+}
+
 void VulkanEngine::createImageViews() {
     swapchainImageViews.resize(swapchainImages.size());
 
@@ -511,7 +1027,8 @@ void VulkanEngine::createRenderPass() {
     colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // offscreen images get read back instead of presented
+    colorAttachmentResolve.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -561,7 +1078,7 @@ void VulkanEngine::createDescriptorSetLayout() {
     VkDescriptorSetLayoutBinding uboLayoutBinding{};
     uboLayoutBinding.binding = 0;
     uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     uboLayoutBinding.pImmutableSamplers = nullptr;
     uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
@@ -572,7 +1089,15 @@ void VulkanEngine::createDescriptorSetLayout() {
     samplerLayoutBinding.pImmutableSamplers = nullptr;
     samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+    VkDescriptorSetLayoutBinding instanceLayoutBinding{};
+    instanceLayoutBinding.binding = 2;
+    instanceLayoutBinding.descriptorCount = 1;
+    instanceLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    instanceLayoutBinding.pImmutableSamplers = nullptr;
+    instanceLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings = { uboLayoutBinding, samplerLayoutBinding,
+                                                             instanceLayoutBinding };
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -581,142 +1106,89 @@ void VulkanEngine::createDescriptorSetLayout() {
     if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor set layout");
     }
-}
 
-void VulkanEngine::createGraphicsPipeline() {
-    auto vertShaderCode = readFile("shaders/shader.vert.spv");
-    auto fragShaderCode = readFile("shaders/shader.frag.spv");
-
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
+    // culling pass: uniforms, draw inputs, instance data, output commands and per-batch counts
+    std::array<VkDescriptorSetLayoutBinding, 5> cullBindings{};
+    for (uint32_t i = 0; i < cullBindings.size(); i++) {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        cullBindings[i].pImmutableSamplers = nullptr;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
 
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
+    layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+    layoutInfo.pBindings = cullBindings.data();
 
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullDescriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout");
+    }
+}
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+void VulkanEngine::createGraphicsPipeline() {
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout");
+    }
 
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    PipelineKey key{};
+    key.layout = pipelineLayout;
+    key.vertexShader = pipelines.loadShader("shaders/shader.vert.spv");
+    key.fragmentShader = pipelines.loadShader("shaders/shader.frag.spv");
+    key.vertexLayout = VERTEX_LAYOUT_MESH;
+    key.blendMode = BLEND_MODE_OPAQUE;
+    key.polygonMode = VK_POLYGON_MODE_FILL;
+    key.cullMode = VK_CULL_MODE_BACK_BIT;
+    key.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    key.depthTest = VK_TRUE;
+    key.depthWrite = VK_TRUE;
+    key.depthCompareOp = VK_COMPARE_OP_LESS;
+    key.colorFormat = swapchainImageFormat;
+    key.depthFormat = findDepthFormat();
+    key.samples = msaaSamples;
+    key.subpass = 0;
+    graphicsPipelineKeys[VERTEX_LAYOUT_MESH] = key;
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
+    key.vertexShader = pipelines.loadShader("shaders/compact.vert.spv");
+    key.vertexLayout = VERTEX_LAYOUT_COMPACT;
+    graphicsPipelineKeys[VERTEX_LAYOUT_COMPACT] = key;
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)swapchainExtent.width;
-    viewport.height = (float)swapchainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
+    // the default pipelines are the fallbacks for every variant, so they're the compiles that block
+    for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++) {
+        graphicsPipelines[layout] = pipelines.compile(graphicsPipelineKeys[layout], renderPass);
+    }
+}
 
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapchainExtent;
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = msaaSamples;
-
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask =
-        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-
-    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = 2;
-    dynamicState.pDynamicStates = dynamicStates;
+void VulkanEngine::createCullPipeline() {
+    auto cullShaderCode = readFile("shaders/cull.comp.spv");
+    VkShaderModule cullShaderModule = createShaderModule(cullShaderCode);
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pSetLayouts = &cullDescriptorSetLayout;
 
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout");
     }
 
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = cullShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = cullPipelineLayout;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics pipeline");
+    if (vkCreateComputePipelines(device, pipelineCache.get(), 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling pipeline");
     }
 
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    vkDestroyShaderModule(device, cullShaderModule, nullptr);
 }
 
 void VulkanEngine::createFramebuffers() {
@@ -751,6 +1223,49 @@ void VulkanEngine::createCommandPool() {
     if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics command pool");
     }
+
+    recorder.init(device, queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, jobs.getThreadCount());
+}
+
+void VulkanEngine::createUploadManager() {
+    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+    uploads.init(device, &allocator, queueFamilyIndices.graphicsFamily.value(), graphicsQueue,
+                 queueFamilyIndices.transferFamily.value(), transferQueue, STAGING_RING_SIZE, &gpuProfiler);
+}
+
+void VulkanEngine::createGeometryPool() {
+    geometry.init(device, &allocator, &uploads, GEOMETRY_POOL_VERTEX_CAPACITY, GEOMETRY_POOL_INDEX_CAPACITY);
+}
+
+void VulkanEngine::createOverlay() {
+    uint32_t graphicsFamily = findQueueFamilies(physicalDevice).graphicsFamily.value();
+    overlay.init(window, instance, physicalDevice, device, graphicsFamily, graphicsQueue, pipelineCache.get(), renderPass,
+                 msaaSamples, MAX_FRAMES_IN_FLIGHT, &gpuProfiler);
+    lastFrameStart = std::chrono::high_resolution_clock::now();
+}
+
+void VulkanEngine::updateOverlay(std::chrono::high_resolution_clock::time_point frameStart) {
+    TURT_TRACE_ZONE("update overlay");
+    overlayStats.frameInterval = std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count();
+    lastFrameStart = frameStart;
+
+    // last is at least one round of frames behind, the profiler only reads back finished frames
+    overlayStats.gpuTime = -1.0;
+    for (const GpuScopeStats& scopeStats : gpuProfiler.getStats()) {
+        if (strcmp(scopeStats.name, "frame") == 0) {
+            overlayStats.gpuTime = scopeStats.last;
+        }
+    }
+
+    overlayStats.objectCount = scene.getCount();
+    overlayStats.cullStats = cullStats;
+    overlayStats.cpuCulling = cpuCulling;
+    overlayStats.uploadBandwidth = overlayStats.frameInterval > 0.0 ?
+        uploads.getStats().lastFrameBytesStaged * 1000.0 / overlayStats.frameInterval : 0.0;
+    overlayStats.memoryStats = allocator.getStats();
+
+    overlay.update(overlayStats);
 }
 
 void VulkanEngine::createColorResources() {
@@ -758,7 +1273,7 @@ void VulkanEngine::createColorResources() {
 
     createImage(swapchainExtent.width, swapchainExtent.height, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageAllocation);
     colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 }
 
@@ -767,7 +1282,7 @@ void VulkanEngine::createDepthResources() {
 
     createImage(swapchainExtent.width, swapchainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL,
                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage,
-                depthImageMemory);
+                depthImageAllocation);
     depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
@@ -791,43 +1306,38 @@ VkFormat VulkanEngine::findDepthFormat() {
                                VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 }
 
-void VulkanEngine::createTextureImage(Drawable& object) {
+void VulkanEngine::createTextureImage(Texture& texture, const std::vector<char>& data) {
+    TURT_TRACE_ZONE("create texture image");
     int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(object.texture, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-    object.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+    stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data.data()), static_cast<int>(data.size()),
+                                            &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
     if (!pixels) {
         throw std::runtime_error("failed to load texture image");
     }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
+    createImage(texWidth, texHeight, texture.mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.image, texture.imageAllocation);
 
-    stbi_image_free(pixels);
+    VkCommandBuffer commandBuffer = uploads.uploadImage(texture.image, pixels, imageSize, static_cast<uint32_t>(texWidth),
+                                                        static_cast<uint32_t>(texHeight), texture.mipLevels);
 
-    createImage(texWidth, texHeight, object.mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, object.textureImage, object.textureImageMemory);
+    stbi_image_free(pixels);
 
-    transitionImageLayout(object.textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, object.mipLevels);
-    copyBufferToImage(stagingBuffer, object.textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
     // transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
+    uint32_t mipmapScope = gpuProfiler.beginScope(commandBuffer, "mipmaps");
+    generateMipmaps(commandBuffer, texture.image, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, texture.mipLevels);
+    gpuProfiler.endScope(commandBuffer, mipmapScope);
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-
-    generateMipmaps(object.textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, object.mipLevels);
+    texture.uploadBatch = uploads.getRecordedBatchId();
 }
 
-void VulkanEngine::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight,
-                                   uint32_t mipLevels) {
+void VulkanEngine::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, int32_t texWidth,
+                                   int32_t texHeight, uint32_t mipLevels) {
     // check if image format supports linear blitting
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
@@ -836,8 +1346,6 @@ void VulkanEngine::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t
         throw std::runtime_error("texture image format does not support linear blitting");
     }
 
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = image;
@@ -898,8 +1406,6 @@ void VulkanEngine::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t
 
     vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
                          nullptr, 0, nullptr, 1, &barrier);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
 VkSampleCountFlagBits VulkanEngine::getMaxUsableSampleCount() {
@@ -918,11 +1424,19 @@ VkSampleCountFlagBits VulkanEngine::getMaxUsableSampleCount() {
     return VK_SAMPLE_COUNT_1_BIT;
 }
 
-void VulkanEngine::createTextureImageView(Drawable& object) {
-    object.textureImageView = createImageView(object.textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, object.mipLevels);
+void VulkanEngine::createTextureImageView(Texture& texture) {
+    texture.imageView = createImageView(texture.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
 }
 
-void VulkanEngine::createTextureSampler(Drawable& object) {
+uint32_t VulkanEngine::acquireTextureSampler(uint32_t mipLevels) {
+    // textures only differ in their lod range, so samplers are shared per mip level count
+    std::string key = std::to_string(mipLevels);
+
+    uint32_t handle;
+    if (samplerCache.acquire(key, handle)) {
+        return handle;
+    }
+
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -938,12 +1452,15 @@ void VulkanEngine::createTextureSampler(Drawable& object) {
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
     samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = static_cast<float>(object.mipLevels);
+    samplerInfo.maxLod = static_cast<float>(mipLevels);
     samplerInfo.mipLodBias = 0.0f;
 
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &object.textureSampler) != VK_SUCCESS) {
+    VkSampler sampler;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler");
     }
+
+    return samplerCache.insert(key, sampler, 0);
 }
 
 VkImageView VulkanEngine::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
@@ -967,22 +1484,9 @@ VkImageView VulkanEngine::createImageView(VkImage image, VkFormat format, VkImag
     return imageView;
 }
 
-uint32_t VulkanEngine::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to find suitable memory type");
-}
-
 void VulkanEngine::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples,
                                VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-                               VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+                               VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageAllocation) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -1002,299 +1506,382 @@ void VulkanEngine::createImage(uint32_t width, uint32_t height, uint32_t mipLeve
         throw std::runtime_error("failed to create image");
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, image, &memRequirements);
+    // render targets are large and get recreated on resize, so they skip the shared blocks
+    bool dedicated = (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+    imageAllocation = allocator.allocateImage(image, properties, dedicated);
+}
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+void VulkanEngine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory");
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create buffer");
     }
 
-    vkBindImageMemory(device, image, imageMemory, 0);
+    bufferAllocation = allocator.allocateBuffer(buffer, properties, false);
 }
 
-void VulkanEngine::transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
-                                         uint32_t mipLevels) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+uint32_t VulkanEngine::acquireMesh(const char* path, VertexLayout vertexLayout) {
+    TURT_TRACE_ZONE("acquire mesh");
+    // the same file in another layout is another mesh
+    std::string key = vertexLayout == VERTEX_LAYOUT_MESH ? path : std::string(path) + ":" + getVertexLayoutName(vertexLayout);
+    uint32_t handle;
+    if (meshCache.acquire(key, handle)) {
+        return handle;
+    }
 
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
+    Mesh mesh{};
+    mesh.vertexLayout = vertexLayout;
+    uint64_t hash;
+    const Vertex* vertices;
+    const void* indices;
 
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
+    // prefer the baked mesh, whose streams are copied from the mapping without any parsing
+    MeshFile meshFile;
+    MeshData data;
+    std::vector<uint16_t> narrow;
+    if (meshFile.open(getBakedMeshPath(path).c_str(), path)) {
+        const MeshFileHeader& header = meshFile.getHeader();
+        // content is shared per layout too
+        hash = header.sourceHash + vertexLayout;
+        if (meshCache.acquireContent(hash, key, handle)) {
+            return handle;
+        }
 
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        mesh.vertexCount = header.vertexCount;
+        // open checked the stored indices are already this type
+        mesh.indexType = getIndexType(header.vertexCount);
+        mesh.indexCount = header.indexCount;
+        mesh.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        mesh.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        vertices = meshFile.getVertices();
+        indices = meshFile.getIndices();
+    } else {
+        MappedFile source;
+        if (!source.open(path)) {
+            throw std::runtime_error("failed to open file");
+        }
 
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-               newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        hash = hashBytes(source.getData(), source.getSize()) + vertexLayout;
+        if (meshCache.acquireContent(hash, key, handle)) {
+            return handle;
+        }
 
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        throw std::invalid_argument("unsupported layout transition");
+        loadObj(source.getData(), source.getSize(), data, jobs);
+        // the same order a bake would store, linear time so it's cheap next to the parse
+        optimizeMesh(data);
+
+        mesh.vertexCount = static_cast<uint32_t>(data.vertices.size());
+        mesh.indexCount = static_cast<uint32_t>(data.indices.size());
+        mesh.boundsMin = data.boundsMin;
+        mesh.boundsMax = data.boundsMax;
+        vertices = data.vertices.data();
+        indices = data.indices.data();
+
+        mesh.indexType = getIndexType(mesh.vertexCount);
+        if (mesh.indexType == VK_INDEX_TYPE_UINT16) {
+            narrow.resize(mesh.indexCount);
+            narrowIndices(data.indices.data(), mesh.indexCount, narrow.data());
+            indices = narrow.data();
+        }
     }
+    mesh.boundingSphere = getBoundingSphere(mesh.boundsMin, mesh.boundsMax);
 
-    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    if (vertexLayout == VERTEX_LAYOUT_COMPACT) {
+        VertexQuantization quantization = getVertexQuantization(mesh.boundsMin, mesh.boundsMax);
+        std::vector<CompactVertex> compact(mesh.vertexCount);
+        compressVertices(vertices, mesh.vertexCount, quantization, compact.data());
+        geometry.allocate(vertexLayout, compact.data(), mesh.vertexCount, mesh.indexType, indices, mesh.indexCount,
+                          mesh.vertexOffset, mesh.firstIndex);
 
-    endSingleTimeCommands(commandBuffer);
-}
-
-void VulkanEngine::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        mesh.positionDecode = glm::scale(glm::translate(glm::mat4(1.0f), quantization.offset), glm::vec3(quantization.scale));
+        glm::vec3 center = (glm::vec3(mesh.boundingSphere) - quantization.offset) / quantization.scale;
+        mesh.vertexSphere = glm::vec4(center, mesh.boundingSphere.w / quantization.scale);
+    } else {
+        geometry.allocate(vertexLayout, vertices, mesh.vertexCount, mesh.indexType, indices, mesh.indexCount,
+                          mesh.vertexOffset, mesh.firstIndex);
 
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { width, height, 1 };
+        mesh.positionDecode = glm::mat4(1.0f);
+        mesh.vertexSphere = mesh.boundingSphere;
+    }
 
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    mesh.uploadBatch = uploads.getRecordedBatchId();
 
-    endSingleTimeCommands(commandBuffer);
+    uint64_t bytes = static_cast<uint64_t>(getVertexStride(vertexLayout)) * mesh.vertexCount +
+                     static_cast<uint64_t>(getIndexSize(mesh.indexType)) * mesh.indexCount;
+    return meshCache.insert(key, hash, std::move(mesh), bytes);
 }
 
-void VulkanEngine::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+uint32_t VulkanEngine::acquireTexture(const char* path) {
+    TURT_TRACE_ZONE("acquire texture");
+    uint32_t handle;
+    if (textureCache.acquire(path, handle)) {
+        return handle;
+    }
 
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create buffer");
+    std::vector<char> data = readFile(path);
+    uint64_t hash = hashBytes(data.data(), data.size());
+    if (textureCache.acquireContent(hash, path, handle)) {
+        return handle;
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+    Texture texture{};
+    createTextureImage(texture, data);
+    createTextureImageView(texture);
+    texture.sampler = acquireTextureSampler(texture.mipLevels);
+    createDescriptorSet(texture);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    uint64_t bytes = texture.imageAllocation.size;
+    return textureCache.insert(path, hash, std::move(texture), bytes);
+}
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory");
+void VulkanEngine::releaseMesh(uint32_t handle) {
+    Mesh mesh;
+    if (meshCache.release(handle, mesh)) {
+        retiredAssets[getLastSubmittedFrame()].meshes.push_back(mesh);
     }
-
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
 
-void VulkanEngine::loadModel(Drawable& object) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string err;
-
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, object.model)) {
-        throw std::runtime_error(err);
+void VulkanEngine::releaseTexture(uint32_t handle) {
+    Texture texture;
+    if (textureCache.release(handle, texture)) {
+        retiredAssets[getLastSubmittedFrame()].textures.push_back(texture);
     }
+}
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+size_t VulkanEngine::getLastSubmittedFrame() const {
+    // currentFrame is the next one to be recorded, which won't reference anything released before it
+    return (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+}
 
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
+void VulkanEngine::destroyRetiredAssets(size_t frameIndex, bool deviceIdle) {
+    RetiredAssets& retired = retiredAssets[frameIndex];
 
-            vertex.pos = { attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1],
-                           attrib.vertices[3 * index.vertex_index + 2] };
+    // an idle device has finished every upload that was submitted, and the ones that weren't never will be
+    auto meshEnd = std::remove_if(retired.meshes.begin(), retired.meshes.end(), [&](const Mesh& mesh) {
+        if (!deviceIdle && !uploads.isComplete(mesh.uploadBatch)) {
+            return false;
+        }
+        destroyMesh(mesh);
+        return true;
+    });
+    retired.meshes.erase(meshEnd, retired.meshes.end());
 
-            vertex.texCoord = { attrib.texcoords[2 * index.texcoord_index + 0],
-                                1.0f - attrib.texcoords[2 * index.texcoord_index + 1] };
+    auto textureEnd = std::remove_if(retired.textures.begin(), retired.textures.end(), [&](Texture& texture) {
+        if (!deviceIdle && !uploads.isComplete(texture.uploadBatch)) {
+            return false;
+        }
+        destroyTexture(texture);
+        return true;
+    });
+    retired.textures.erase(textureEnd, retired.textures.end());
+}
 
-            vertex.color = { 1.0f, 1.0f, 1.0f };
+void VulkanEngine::destroyMesh(const Mesh& mesh) {
+    geometry.free(mesh.vertexLayout, mesh.indexType, mesh.vertexOffset, mesh.firstIndex);
+}
 
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(object.vertices.size());
-                object.vertices.push_back(vertex);
-            }
+void VulkanEngine::destroyTexture(Texture& texture) {
+    vkFreeDescriptorSets(device, descriptorPool, 1, &texture.descriptorSet);
+    releaseTextureSampler(texture.sampler);
 
-            object.indices.push_back(uniqueVertices[vertex]);
-        }
+    vkDestroyImageView(device, texture.imageView, nullptr);
+    vkDestroyImage(device, texture.image, nullptr);
+    allocator.free(texture.imageAllocation);
+}
+
+void VulkanEngine::releaseTextureSampler(uint32_t handle) {
+    VkSampler sampler;
+    if (samplerCache.release(handle, sampler)) {
+        vkDestroySampler(device, sampler, nullptr);
     }
 }
 
-void VulkanEngine::createVertexBuffer(Drawable& object) {
-    VkDeviceSize bufferSize = sizeof(object.vertices[0]) * object.vertices.size();
+void VulkanEngine::createFrameArenas() {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    drawCapacity = INITIAL_DRAW_CAPACITY;
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, object.vertices.data(), (size_t)bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
+    uniformArena.init(device, &allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                      properties.limits.minUniformBufferOffsetAlignment, UNIFORM_ARENA_FRAME_SIZE, MAX_FRAMES_IN_FLIGHT);
 
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, object.vertexBuffer, object.vertexBufferMemory);
+    instanceArena.init(device, &allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                       properties.limits.minStorageBufferOffsetAlignment, sizeof(InstanceData) * drawCapacity,
+                       MAX_FRAMES_IN_FLIGHT);
 
-    copyBuffer(stagingBuffer, object.vertexBuffer, bufferSize);
+    drawInputArena.init(device, &allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        properties.limits.minStorageBufferOffsetAlignment, sizeof(CullDraw) * drawCapacity,
+                        MAX_FRAMES_IN_FLIGHT);
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    createDrawCommandBuffers();
 }
 
-void VulkanEngine::createIndexBuffer(Drawable& object) {
-    VkDeviceSize bufferSize = sizeof(object.indices[0]) * object.indices.size();
+void VulkanEngine::reserveFrameArenas(size_t objectCount) {
+    if (objectCount <= drawCapacity) {
+        return;
+    }
+
+    // the old buffers may still be read by frames in flight and the descriptor sets point at them
+    vkDeviceWaitIdle(device);
+    drawCapacity = std::max(static_cast<uint32_t>(objectCount), drawCapacity * 2);
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    instanceArena.resize(instanceArena.alignSize(sizeof(InstanceData) * drawCapacity));
+    drawInputArena.resize(drawInputArena.alignSize(sizeof(CullDraw) * drawCapacity));
+    destroyDrawCommandBuffers();
+    createDrawCommandBuffers();
 
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, object.indices.data(), (size_t)bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
+    textureCache.forEach([this](const Texture& texture) { updateDescriptorSet(texture); });
+    updateCullDescriptorSet();
+}
 
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, object.indexBuffer, object.indexBufferMemory);
+void VulkanEngine::createDrawCommandBuffers() {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-    copyBuffer(stagingBuffer, object.indexBuffer, bufferSize);
+    // regions are bound with dynamic offsets, so each one starts on a storage buffer alignment boundary
+    VkDeviceSize alignment = properties.limits.minStorageBufferOffsetAlignment;
+    // there are never more draws than objects, since each draw takes at least one
+    drawCommandRegionSize = (sizeof(VkDrawIndexedIndirectCommand) * drawCapacity + alignment - 1) / alignment * alignment;
+    visibleInstanceRegionSize = (sizeof(InstanceData) * drawCapacity + alignment - 1) / alignment * alignment;
 
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    createBuffer(drawCommandRegionSize * MAX_FRAMES_IN_FLIGHT,
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, drawCommandBuffer, drawCommandBufferAllocation);
+    createBuffer(visibleInstanceRegionSize * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibleInstanceBuffer, visibleInstanceBufferAllocation);
 }
 
-void VulkanEngine::createUniformBuffers(Drawable& object) {
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+void VulkanEngine::destroyDrawCommandBuffers() {
+    vkDestroyBuffer(device, visibleInstanceBuffer, nullptr);
+    allocator.free(visibleInstanceBufferAllocation);
 
-    object.uniformBuffers.resize(swapchainImages.size());
-    object.uniformBuffersMemory.resize(swapchainImages.size());
-
-    for (size_t i = 0; i < swapchainImages.size(); i++) {
-        createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, object.uniformBuffers[i], object.uniformBuffersMemory[i]);
-    }
+    vkDestroyBuffer(device, drawCommandBuffer, nullptr);
+    allocator.free(drawCommandBufferAllocation);
 }
 
 void VulkanEngine::createDescriptorPool() {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(swapchainImages.size());
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = MAX_DESCRIPTOR_SETS;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = static_cast<uint32_t>(swapchainImages.size());
+    poolSizes[1].descriptorCount = MAX_DESCRIPTOR_SETS;
+    // the culling set takes one more uniform buffer and four storage buffers
+    poolSizes[0].descriptorCount += 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = MAX_DESCRIPTOR_SETS + 4;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(swapchainImages.size() * 8);
+    poolInfo.maxSets = MAX_DESCRIPTOR_SETS + 1;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 
     if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool");
     }
 }
 
-void VulkanEngine::createDescriptorSets(Drawable& object) {
-    std::vector<VkDescriptorSetLayout> layouts(swapchainImages.size(), descriptorSetLayout);
+void VulkanEngine::createDescriptorSet(Texture& texture) {
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(swapchainImages.size());
-    allocInfo.pSetLayouts = layouts.data();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
 
-    object.descriptorSets.resize(swapchainImages.size());
-    if (vkAllocateDescriptorSets(device, &allocInfo, object.descriptorSets.data()) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(device, &allocInfo, &texture.descriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets");
     }
 
-    for (size_t i = 0; i < swapchainImages.size(); i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = object.uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
+    updateDescriptorSet(texture);
+}
 
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        imageInfo.imageView = object.textureImageView;
-        imageInfo.sampler = object.textureSampler;
+void VulkanEngine::updateDescriptorSet(const Texture& texture) {
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = uniformArena.getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(UniformBufferObject);
 
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = texture.imageView;
+    imageInfo.sampler = samplerCache.get(texture.sampler);
 
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = object.descriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
+    // the culling pass leaves each frame's visible instances in that frame's region
+    VkDescriptorBufferInfo instanceInfo{};
+    instanceInfo.buffer = visibleInstanceBuffer;
+    instanceInfo.offset = 0;
+    instanceInfo.range = visibleInstanceRegionSize;
 
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = object.descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
 
-        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0,nullptr);
-    }
-}
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = texture.descriptorSet;
+    descriptorWrites[0].dstBinding = 0;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &bufferInfo;
 
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = texture.descriptorSet;
+    descriptorWrites[1].dstBinding = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pImageInfo = &imageInfo;
 
-VkCommandBuffer VulkanEngine::beginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[2].dstSet = texture.descriptorSet;
+    descriptorWrites[2].dstBinding = 2;
+    descriptorWrites[2].dstArrayElement = 0;
+    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    descriptorWrites[2].descriptorCount = 1;
+    descriptorWrites[2].pBufferInfo = &instanceInfo;
 
-    return commandBuffer;
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
-void VulkanEngine::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+void VulkanEngine::createCullDescriptorSet() {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &cullDescriptorSetLayout;
 
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    if (vkAllocateDescriptorSets(device, &allocInfo, &cullDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets");
+    }
 
-    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    updateCullDescriptorSet();
 }
 
-void VulkanEngine::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+void VulkanEngine::updateCullDescriptorSet() {
+    // the instance array and the draw inputs are the first allocation of their arena each frame
+    std::array<VkDescriptorBufferInfo, 5> bufferInfos{};
+    bufferInfos[0] = { uniformArena.getBuffer(), 0, sizeof(CullUniforms) };
+    bufferInfos[1] = { drawInputArena.getBuffer(), 0, drawInputArena.getFrameCapacity() };
+    bufferInfos[2] = { instanceArena.getBuffer(), 0, instanceArena.getFrameCapacity() };
+    bufferInfos[3] = { drawCommandBuffer, 0, drawCommandRegionSize };
+    bufferInfos[4] = { visibleInstanceBuffer, 0, visibleInstanceRegionSize };
 
-    VkBufferCopy copyRegion{};
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
+    for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = cullDescriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+    }
 
-    endSingleTimeCommands(commandBuffer);
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
 
 void VulkanEngine::createCommandBuffers() {
@@ -1311,7 +1898,8 @@ void VulkanEngine::createCommandBuffers() {
     }
 }
 
-void VulkanEngine::recordCommandBuffer(uint32_t currentImage) {
+void VulkanEngine::recordCommandBuffer(uint32_t currentImage, uint32_t frameIndex) {
+    TURT_TRACE_ZONE("record command buffer");
     if (vkResetCommandBuffer(commandBuffers[currentImage], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT) != VK_SUCCESS) {
         throw std::runtime_error("failed to reset command buffer");
     }
@@ -1337,10 +1925,87 @@ void VulkanEngine::recordCommandBuffer(uint32_t currentImage) {
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(commandBuffers[currentImage], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    uint32_t frameScope = gpuProfiler.beginScope(commandBuffers[currentImage], "frame");
+
+    uint32_t cullScope = gpuProfiler.beginScope(commandBuffers[currentImage], "culling");
+    recordCulling(commandBuffers[currentImage]);
+    gpuProfiler.endScope(commandBuffers[currentImage], cullScope);
+
+    uint32_t renderPassScope = gpuProfiler.beginScope(commandBuffers[currentImage], "render pass");
+    vkCmdBeginRenderPass(commandBuffers[currentImage], &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    // the draws are recorded into secondary command buffers across the job system
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = swapchainFramebuffers[currentImage];
+
+    // variants compile in the background, the default pipelines draw until they're ready
+    for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++) {
+        PipelineKey pipelineKey = graphicsPipelineKeys[layout];
+        pipelineKey.polygonMode = wireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
+        framePipelines[layout] = pipelines.get(pipelineKey, renderPass, graphicsPipelines[layout]);
+    }
+
+    // chunks split the indirect draws rather than the batches, there are only a few batches once objects are instanced
+    uint32_t drawCount = frameBatches.empty() ? 0 : frameBatches.back().firstDraw + frameBatches.back().drawCount;
+
+    recorder.beginFrame(frameIndex);
+    const std::vector<VkCommandBuffer>& secondaryCommandBuffers = recorder.record(
+        jobs, inheritanceInfo, drawCount,
+        [this](VkCommandBuffer commandBuffer, uint32_t first, uint32_t last) { recordDraws(commandBuffer, first, last); });
+
+    vkCmdExecuteCommands(commandBuffers[currentImage], static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                         secondaryCommandBuffers.data());
+
+    // drawn last so it sits on top of the scene
+    VkCommandBuffer overlayCommandBuffer = headless ? VK_NULL_HANDLE : overlay.record(frameIndex, inheritanceInfo);
+    if (overlayCommandBuffer != VK_NULL_HANDLE) {
+        vkCmdExecuteCommands(commandBuffers[currentImage], 1, &overlayCommandBuffer);
+    }
+
+    vkCmdEndRenderPass(commandBuffers[currentImage]);
+    gpuProfiler.endScope(commandBuffers[currentImage], renderPassScope);
+
+    gpuProfiler.endScope(commandBuffers[currentImage], frameScope);
+
+    if (vkEndCommandBuffer(commandBuffers[currentImage]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record command buffer");
+    }
+}
+
+void VulkanEngine::recordCulling(VkCommandBuffer commandBuffer) {
+    vkCmdFillBuffer(commandBuffer, drawCommandBuffer, drawCommandOffset, drawCommandRegionSize, 0);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
 
-    vkCmdBindPipeline(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    uint32_t dynamicOffsets[] = { cullUniformOffset, drawInputOffset, instanceOffset, drawCommandOffset, visibleInstanceOffset };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSet,
+                            5, dynamicOffsets);
+
+    uint32_t drawCount = cullStats.visibleCount;
+    if (drawCount > 0) {
+        vkCmdDispatch(commandBuffer, (drawCount + 63) / 64, 1, 1);
+    }
 
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+}
+
+void VulkanEngine::recordDraws(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last) const {
+    TURT_TRACE_ZONE("record draws");
+    // secondary command buffers inherit no state, each one sets up its own
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -1348,31 +2013,53 @@ void VulkanEngine::recordCommandBuffer(uint32_t currentImage) {
     viewport.height = static_cast<float>(swapchainExtent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffers[currentImage], 0, 1, &viewport);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = { 0, 0 };
     scissor.extent = { swapchainExtent.width, swapchainExtent.height };
-    vkCmdSetScissor(commandBuffers[currentImage], 0, 1, &scissor);
-
-    for (const Drawable& object : objects) {
-        VkBuffer vertexBuffers[] = { object.vertexBuffer };
-        VkDeviceSize offsets[] = { 0 };
-
-        vkCmdBindVertexBuffers(commandBuffers[currentImage], 0, 1, vertexBuffers, offsets);
-
-        vkCmdBindIndexBuffer(commandBuffers[currentImage], object.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-
-        vkCmdBindDescriptorSets(commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-                                &object.descriptorSets[currentImage], 0, nullptr);
-
-        vkCmdDrawIndexed(commandBuffers[currentImage], static_cast<uint32_t>(object.indices.size()), 1, 0, 0, 0);
-    }
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    VertexLayout boundLayout = VERTEX_LAYOUT_COUNT;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+    // the batch holding the first draw, batches are laid out back to back in draw order
+    auto batchIt = std::upper_bound(frameBatches.begin(), frameBatches.end(), first,
+                                    [](uint32_t draw, const FrameBatch& batch) { return draw < batch.firstDraw; });
+    for (batchIt = batchIt == frameBatches.begin() ? batchIt : batchIt - 1;
+         batchIt != frameBatches.end() && batchIt->firstDraw < last; ++batchIt) {
+        const FrameBatch& batch = *batchIt;
+        const Texture& texture = textureCache.get(batch.texture);
+
+        // the pipeline layout stays the same, so switching pipelines keeps the descriptor sets bound
+        if (batch.vertexLayout != boundLayout) {
+            boundLayout = batch.vertexLayout;
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, framePipelines[boundLayout]);
+
+            VkBuffer vertexBuffers[] = { geometry.getVertexBuffer(boundLayout) };
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        }
 
-    vkCmdEndRenderPass(commandBuffers[currentImage]);
+        // both index types live in the same buffer, only the binding's type changes
+        if (batch.indexType != boundIndexType) {
+            boundIndexType = batch.indexType;
+            vkCmdBindIndexBuffer(commandBuffer, geometry.getIndexBuffer(), 0, boundIndexType);
+        }
 
-    if (vkEndCommandBuffer(commandBuffers[currentImage]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to record command buffer");
+        uint32_t dynamicOffsets[] = { uniformOffset, visibleInstanceOffset };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
+                                &texture.descriptorSet, 2, dynamicOffsets);
+
+        // a chunk may start or end partway through a batch
+        uint32_t batchFirst = std::max(batch.firstDraw, first);
+        uint32_t batchLast = std::min(batch.firstDraw + batch.drawCount, last);
+        for (uint32_t drawn = batchFirst; drawn < batchLast; drawn += maxDrawIndirectCount) {
+            uint32_t drawCount = std::min(batchLast - drawn, maxDrawIndirectCount);
+            VkDeviceSize offset = drawCommandOffset + static_cast<VkDeviceSize>(drawn) * stride;
+            vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffer, offset, drawCount, stride);
+        }
     }
 }
 
@@ -1380,6 +2067,7 @@ void VulkanEngine::createSyncObjects() {
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    retiredAssets.resize(MAX_FRAMES_IN_FLIGHT);
     imagesInFlight.resize(swapchainImages.size());
 
     VkSemaphoreCreateInfo semaphoreInfo{};
@@ -1398,49 +2086,170 @@ void VulkanEngine::createSyncObjects() {
     }
 }
 
-void VulkanEngine::updateUniformBuffer(uint32_t currentImage) {
-    for (Drawable& object : objects) {
-        object.ubo.view = camera.viewMatrix;
-        if (object.update != nullptr) {
-            object.update(&object);
+void VulkanEngine::updateUniformBuffer(uint32_t frameIndex) {
+    TURT_TRACE_ZONE("update");
+    camera.projMatrix = glm::perspective(glm::radians(45.0f), (float)swapchainExtent.width / (float)swapchainExtent.height, 0.1f, 100.0f);
+    camera.projMatrix[1][1] *= -1.0f;
+
+    UniformBufferObject ubo{};
+    ubo.view = camera.viewMatrix;
+    ubo.proj = camera.projMatrix;
+
+    uniformArena.beginFrame(frameIndex);
+    uniformOffset = uniformArena.push(&ubo, sizeof(ubo));
+
+    if (headless) {
+        animationTime += 1.0 / 60.0;
+    } else {
+        animationTime = glfwGetTime() - animationStartTime;
+    }
+    scene.update(animationTime);
+
+    Frustum frustum = extractFrustum(camera.projMatrix * camera.viewMatrix);
+    cullObjects(frustum);
+
+    uint32_t drawCount = cullStats.visibleCount;
+
+    CullUniforms cullUniforms{};
+    std::copy(frustum.planes, frustum.planes + 6, cullUniforms.planes);
+    cullUniforms.drawCount = drawCount;
+    cullUniforms.testFrustum = !cpuCulling;
+    cullUniformOffset = uniformArena.push(&cullUniforms, sizeof(cullUniforms));
+
+    instanceArena.beginFrame(frameIndex);
+    InstanceData* instances = instanceArena.allocateArray<InstanceData>(drawCount, instanceOffset);
+
+    drawInputArena.beginFrame(frameIndex);
+    CullDraw* draws = drawInputArena.allocateArray<CullDraw>(drawCount, drawInputOffset);
+
+    drawCommandOffset = static_cast<uint32_t>(frameIndex * drawCommandRegionSize);
+    visibleInstanceOffset = static_cast<uint32_t>(frameIndex * visibleInstanceRegionSize);
+
+    // visible objects are packed, so batches shrink and shift from frame to frame
+    // instance offsets are relative to the start of the frame's instance array
+    // objects sharing a mesh sit together within a batch, and each such run becomes one instanced draw
+    const std::vector<uint32_t>& drawOrder = scene.getDrawOrder();
+    const std::vector<glm::mat4>& models = scene.getModels();
+    const std::vector<uint32_t>& meshes = scene.getMeshes();
+
+    frameBatches.clear();
+    uint32_t drawIndex = 0;
+    uint32_t groupCount = 0;
+    uint64_t triangleCount = 0;
+    for (const DrawBatch& batch : scene.getDrawBatches()) {
+        FrameBatch frameBatch = { batch.texture, VERTEX_LAYOUT_MESH, VK_INDEX_TYPE_UINT16, groupCount, 0 };
+        uint32_t batchEnd = batch.firstDraw + batch.drawCount;
+
+        for (uint32_t i = batch.firstDraw; i < batchEnd;) {
+            uint32_t meshHandle = meshes[drawOrder[i]];
+            const Mesh& mesh = meshCache.get(meshHandle);
+
+            if (mesh.vertexLayout != frameBatch.vertexLayout || mesh.indexType != frameBatch.indexType) {
+                if (frameBatch.drawCount > 0) {
+                    frameBatches.push_back(frameBatch);
+                }
+                frameBatch = { batch.texture, mesh.vertexLayout, mesh.indexType, groupCount, 0 };
+            }
+
+            // the culling pass fills in the instance count
+            VkDrawIndexedIndirectCommand command{};
+            command.indexCount = mesh.indexCount;
+            command.firstIndex = mesh.firstIndex;
+            command.vertexOffset = static_cast<int32_t>(mesh.vertexOffset);
+            command.firstInstance = drawIndex;
+
+            for (; i < batchEnd && meshes[drawOrder[i]] == meshHandle; i++) {
+                uint32_t object = drawOrder[i];
+                if (!objectVisible[object]) {
+                    continue;
+                }
+
+                // quantized positions are decoded by the instance's model matrix
+                if (mesh.vertexLayout == VERTEX_LAYOUT_MESH) {
+                    instances[drawIndex].model = models[object];
+                } else {
+                    instances[drawIndex].model = models[object] * mesh.positionDecode;
+                }
+
+                CullDraw& draw = draws[drawIndex];
+                draw.command = command;
+                draw.group = groupCount;
+                draw.boundingSphere = mesh.vertexSphere;
+
+                drawIndex++;
+                triangleCount += mesh.indexCount / 3;
+            }
+
+            if (drawIndex > command.firstInstance) {
+                groupCount++;
+                frameBatch.drawCount++;
+            }
         }
 
-        void* data;
-        vkMapMemory(device, object.uniformBuffersMemory[currentImage], 0, sizeof(object.ubo), 0, &data);
-        memcpy(data, &object.ubo, sizeof(object.ubo));
-        vkUnmapMemory(device, object.uniformBuffersMemory[currentImage]);
+        if (frameBatch.drawCount > 0) {
+            frameBatches.push_back(frameBatch);
+        }
     }
+
+    // what goes to the culling pass, the gpu may still drop some of it
+    overlayStats.drawCount = groupCount;
+    overlayStats.triangleCount = triangleCount;
 }
 
-void VulkanEngine::createDrawable(const char* texture, const char* model, void (*updateFunc)(Drawable* self)) {
-    Drawable object{};
-    object.texture = texture;
-    object.model = model;
+void VulkanEngine::cullObjects(const Frustum& frustum) {
+    TURT_TRACE_ZONE("cull objects");
+    uint32_t objectCount = scene.getCount();
+    objectVisible.resize(objectCount);
+
+    if (!cpuCulling) {
+        // everything goes to the culling pass on the gpu
+        std::fill(objectVisible.begin(), objectVisible.end(), 1);
+        cullStats.visibleCount = objectCount;
+        cullStats.culledCount = 0;
+        return;
+    }
 
-    object.ubo.model = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
-    object.ubo.proj = glm::perspective(glm::radians(45.0f), (float)swapchainExtent.width / (float)swapchainExtent.height, 0.1f, 100.0f);
-    object.ubo.proj[1][1] *= -1.0f;
+    scene.computeWorldSpheres(worldSpheres, jobs);
+    cullStats = cullSpheres(frustum, worldSpheres, objectVisible.data(), jobs);
+}
 
-    object.update = updateFunc;
+uint32_t VulkanEngine::createDrawable(const char* texture, const char* model, UpdateFunc updateFunc, uint32_t parent,
+                                      VertexLayout vertexLayout) {
+    reserveFrameArenas(scene.getCount() + 1);
+    uint32_t mesh = acquireMesh(model, vertexLayout);
+    uint32_t textureHandle = acquireTexture(texture);
 
-    loadModel(object);
-    createVertexBuffer(object);
-    createIndexBuffer(object);
-    createUniformBuffers(object);
-    createTextureImage(object);
-    createTextureImageView(object);
-    createTextureSampler(object);
-    createDescriptorSets(object);
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+    return scene.create(mesh, textureHandle, meshCache.get(mesh).boundingSphere, transform, updateFunc, parent);
+}
 
-    objects.push_back(object);
+void VulkanEngine::destroyDrawable(uint32_t handle) {
+    uint32_t index = scene.getIndex(handle);
+    releaseTexture(scene.getTextures()[index]);
+    releaseMesh(scene.getMeshes()[index]);
+    scene.destroy(handle);
 }
 
 void VulkanEngine::drawFrame() {
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    TURT_TRACE_FRAME();
+    TURT_TRACE_ZONE("draw frame");
+    auto frameStart = std::chrono::high_resolution_clock::now();
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame],
-                                            VK_NULL_HANDLE, &imageIndex);
+    {
+        TURT_TRACE_ZONE("wait for frame");
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+    destroyRetiredAssets(currentFrame);
+    auto cpuStart = std::chrono::high_resolution_clock::now();
+
+    // offscreen images are used round robin, one per frame in flight
+    uint32_t imageIndex = static_cast<uint32_t>(currentFrame);
+    VkResult result = VK_SUCCESS;
+    if (!headless) {
+        TURT_TRACE_ZONE("acquire image");
+        result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame],
+                                       VK_NULL_HANDLE, &imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapchain();
@@ -1449,21 +2258,33 @@ void VulkanEngine::drawFrame() {
         throw std::runtime_error("failed to acquire swap chain image");
     }
 
-    updateUniformBuffer(imageIndex);
+    updateUniformBuffer(static_cast<uint32_t>(currentFrame));
 
     if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+        TURT_TRACE_ZONE("wait for image");
         vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
     }
     imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
-    recordCommandBuffer(imageIndex);
+    // anything created since the last frame has to be submitted ahead of the draws that use it
+    {
+        TURT_TRACE_ZONE("flush uploads");
+        uploads.beginFrame();
+        gpuProfiler.beginFrame(static_cast<uint32_t>(currentFrame));
+    }
+
+    if (!headless) {
+        updateOverlay(frameStart);
+    }
+
+    recordCommandBuffer(imageIndex, static_cast<uint32_t>(currentFrame));
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
@@ -1471,13 +2292,23 @@ void VulkanEngine::drawFrame() {
     submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
 
     VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer");
+    {
+        TURT_TRACE_ZONE("submit");
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer");
+        }
+    }
+    overlayStats.cpuTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cpuStart).count();
+
+    lastImageIndex = imageIndex;
+    if (headless) {
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return;
     }
 
     VkPresentInfoKHR presentInfo{};
@@ -1492,7 +2323,10 @@ void VulkanEngine::drawFrame() {
 
     presentInfo.pImageIndices = &imageIndex;
 
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    {
+        TURT_TRACE_ZONE("present");
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
@@ -1587,8 +2421,8 @@ bool VulkanEngine::isDeviceSuitable(VkPhysicalDevice physicalDeviceIn) {
 
     bool extensionsSupported = checkDeviceExtensionSupport(physicalDeviceIn);
 
-    bool swapchainAdequate = false;
-    if (extensionsSupported) {
+    bool swapchainAdequate = headless;
+    if (extensionsSupported && !headless) {
         SwapchainSupportDetails swapchainSupport = querySwapchainSupport(physicalDeviceIn);
         swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
     }
@@ -1597,7 +2431,7 @@ bool VulkanEngine::isDeviceSuitable(VkPhysicalDevice physicalDeviceIn) {
     vkGetPhysicalDeviceFeatures(physicalDeviceIn, &supportedFeatures);
 
     return queueFamilyIndices.isComplete() && extensionsSupported && swapchainAdequate &&
-           supportedFeatures.samplerAnisotropy;
+           supportedFeatures.samplerAnisotropy && supportedFeatures.drawIndirectFirstInstance;
 }
 
 bool VulkanEngine::checkDeviceExtensionSupport(VkPhysicalDevice physicalDeviceIn) {
@@ -1608,6 +2442,9 @@ bool VulkanEngine::checkDeviceExtensionSupport(VkPhysicalDevice physicalDeviceIn
     vkEnumerateDeviceExtensionProperties(physicalDeviceIn, nullptr, &extensionCount, availableExtensions.data());
 
     std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    if (headless) {
+        requiredExtensions.clear();
+    }
 
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
@@ -1631,8 +2468,11 @@ QueueFamilyIndices VulkanEngine::findQueueFamilies(VkPhysicalDevice physicalDevi
             indices.graphicsFamily = i;
         }
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDeviceIn, i, surface, &presentSupport);
+        // nothing gets presented without a window, so the graphics queue stands in
+        VkBool32 presentSupport = headless && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+        if (!headless) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDeviceIn, i, surface, &presentSupport);
+        }
 
         if (presentSupport) {
             indices.presentFamily = i;
@@ -1645,14 +2485,28 @@ QueueFamilyIndices VulkanEngine::findQueueFamilies(VkPhysicalDevice physicalDevi
         i++;
     }
 
+    // prefer a family that only does transfers, which usually maps to a dedicated copy engine
+    indices.transferFamily = indices.graphicsFamily;
+    for (uint32_t family = 0; family < queueFamilyCount; family++) {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            indices.transferFamily = family;
+            break;
+        }
+    }
+
     return indices;
 }
 
 std::vector<const char*> VulkanEngine::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // without a window there is no surface to create
+    if (!headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -5,9 +5,22 @@
 
 #include <glm/glm.hpp>
 
-#include "imgui/imgui.h"
-#include "imgui/imgui_impl_vulkan.h"
-#include "imgui/imgui_impl_glfw.h"
+#include "turt_allocator.h"
+#include "turt_asset_cache.h"
+#include "turt_benchmark.h"
+#include "turt_culling.h"
+#include "turt_frame_arena.h"
+#include "turt_geometry.h"
+#include "turt_gpu_profiler.h"
+#include "turt_mesh.h"
+#include "turt_mesh_optimizer.h"
+#include "turt_overlay.h"
+#include "turt_pipeline_cache.h"
+#include "turt_pipelines.h"
+#include "turt_recorder.h"
+#include "turt_scene.h"
+#include "turt_trace.h"
+#include "turt_upload.h"
 
 #include <iostream>
 #include <fstream>
@@ -15,6 +28,7 @@
 #include <algorithm>
 #include <chrono>
 #include <vector>
+#include <string>
 #include <cstring>
 #include <cstdlib>
 #include <array>
@@ -22,86 +36,73 @@
 #include <set>
 #include <unordered_map>
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-        return attributeDescriptions;
-    }
-
-    bool operator==(const Vertex& other) const {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord;
-    }
-};
-
 struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
 };
 
+// per-draw data read by the vertex shader through gl_InstanceIndex
+struct InstanceData {
+    alignas(16) glm::mat4 model;
+};
+
 struct Shader {
 
 };
 
-struct Drawable {
-    const char* texture;
-    const char* model;
+struct Mesh {
+    VertexLayout vertexLayout;
+
+    // ranges in the engine's geometry pool
+    uint32_t vertexCount;
+    uint32_t vertexOffset;
+
+    // 16 bit whenever the vertex count allows, firstIndex counts indices of this type
+    VkIndexType indexType;
+    uint32_t indexCount;
+    uint32_t firstIndex;
 
-    std::vector<Vertex> vertices;
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec4 boundingSphere;
 
-    std::vector<uint32_t> indices;
-    VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    // takes the layout's positions to mesh space, identity unless they're quantized
+    glm::mat4 positionDecode;
+    // boundingSphere in the layout's position space, what the culling pass tests against
+    glm::vec4 vertexSphere;
 
-    UniformBufferObject ubo;
-    std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> uniformBuffersMemory;
+    // the upload copying the geometry in, the ranges can't be reused before it completes
+    uint64_t uploadBatch;
+};
 
-    std::vector<VkDescriptorSet> descriptorSets;
+// a scene batch cut wherever the vertex layout or index type changes
+// each layout has its own pipeline and vertex buffer, each index type its own index buffer binding
+struct FrameBatch {
+    uint32_t texture;
+    VertexLayout vertexLayout;
+    VkIndexType indexType;
+    uint32_t firstDraw;
+    uint32_t drawCount;
+};
 
-    VkImage textureImage;
-    VkDeviceMemory textureImageMemory;
+struct Texture {
+    VkImage image;
+    Allocation imageAllocation;
     uint32_t mipLevels;
-    VkImageView textureImageView;
-    VkSampler textureSampler;
+    VkImageView imageView;
+    uint32_t sampler;
 
-    void (*update)(Drawable* self);
+    VkDescriptorSet descriptorSet;
+
+    // the upload copying the pixels in and generating mipmaps, the image can't be destroyed before it completes
+    uint64_t uploadBatch;
 };
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // a transfer-only family when the device has one, otherwise the graphics family
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete() const {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -121,15 +122,59 @@ struct Camera {
     float yaw;
     float pitch;
     glm::mat4 viewMatrix;
+    glm::mat4 projMatrix;
+};
+
+struct ResizeStats {
+    uint32_t count = 0;
+    // milliseconds, summed over all resizes
+    double totalTime = 0.0;
+    double waitTime = 0.0;
+    double maxTime = 0.0;
+};
+
+struct HeadlessOptions {
+    uint32_t width = 800;
+    uint32_t height = 600;
+    uint32_t frameCount = 1000;
+    // the last frame is written here as a png, unless empty
+    std::string imagePath;
+    // gpu scope timings are written here as csv, unless empty
+    std::string profilePath;
 };
 
 class VulkanEngine {
 public:
     void run();
 
+    // renders into offscreen images with no window or surface and reports frame timings
+    void runHeadless(const HeadlessOptions& options);
+
+    // renders a benchmark script headlessly and reads back its last frame
+    void runBenchmark(const BenchmarkScript& script, BenchmarkResult& result);
+
+    const std::vector<GpuScopeStats>& getGpuStats() const { return gpuProfiler.getStats(); }
+
+    // resizes the window over and over, rendering in between, and reports how long each resize stalled
+    void runResizeBenchmark(uint32_t resizeCount);
+
+    // times writing per-object constants the way objects used to, one map/memcpy/unmap each,
+    // against bump allocating them out of a frame arena
+    void runUniformBenchmark(const std::vector<uint32_t>& objectCounts);
+
+    // the transform is relative to the parent drawable when one is given
+    uint32_t createDrawable(const char* texture, const char* model, UpdateFunc updateFunc,
+                            uint32_t parent = Scene::NO_PARENT, VertexLayout vertexLayout = VERTEX_LAYOUT_MESH);
+
+    // children keep their place in the world under the drawable's parent
+    // the mesh and texture are only destroyed once no frame in flight can be drawing them
+    void destroyDrawable(uint32_t handle);
+
 private:
     GLFWwindow* window;
 
+    JobSystem jobs;
+
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkSurfaceKHR surface;
@@ -137,11 +182,29 @@ private:
     VkPhysicalDevice physicalDevice;
     VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_8_BIT;
     VkDevice device;
+    // 1 when the device can't draw several indirect commands in one call
+    uint32_t maxDrawIndirectCount = 1;
+    // frustum culling on the cpu before the draws are written, instead of in the culling pass
+    bool cpuCulling = false;
+
+    MemoryAllocator allocator;
+
+    PipelineCache pipelineCache;
+    PipelineLibrary pipelines;
 
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;
+
+    UploadManager uploads;
+
+    GpuProfiler gpuProfiler;
+    // lets the profiler recycle queries without recording a reset
+    bool hostQueryReset = false;
+
+    GeometryPool geometry;
 
-    VkSwapchainKHR swapchain;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
     std::vector<VkImage> swapchainImages;
     VkFormat swapchainImageFormat;
     VkExtent2D swapchainExtent;
@@ -151,19 +214,90 @@ private:
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    // one per vertex layout, compiled up front and drawn with until the variant a frame asks for is ready
+    std::array<VkPipeline, VERTEX_LAYOUT_COUNT> graphicsPipelines;
+    std::array<PipelineKey, VERTEX_LAYOUT_COUNT> graphicsPipelineKeys;
+    // what this frame's draws bind, by vertex layout
+    std::array<VkPipeline, VERTEX_LAYOUT_COUNT> framePipelines;
+
+    // F switches to a wireframe variant when the device can rasterize lines
+    bool wireframeSupported = false;
+    bool wireframe = false;
+    bool wireframeKeyDown = false;
+
+    // F1 shows and hides it, never created when headless
+    Overlay overlay;
+    bool overlayKeyDown = false;
+    // what the overlay shows about the last frame
+    OverlayStats overlayStats;
+    std::chrono::high_resolution_clock::time_point lastFrameStart;
+    // glfw time the animation counts from, unused when headless
+    double animationStartTime = 0.0;
+    // seconds since the first frame, stepped at a fixed rate when headless so runs are repeatable
+    double animationTime = 0.0;
+
+    VkDescriptorSetLayout cullDescriptorSetLayout;
+    VkPipelineLayout cullPipelineLayout;
+    VkPipeline cullPipeline;
+    VkDescriptorSet cullDescriptorSet;
 
     VkCommandPool commandPool;
 
+    CommandRecorder recorder;
+
     VkImage colorImage;
-    VkDeviceMemory colorImageMemory;
+    Allocation colorImageAllocation;
     VkImageView colorImageView;
 
     VkImage depthImage;
-    VkDeviceMemory depthImageMemory;
+    Allocation depthImageAllocation;
     VkImageView depthImageView;
 
-    std::vector<Drawable> objects;
+    Scene scene;
+
+    // this frame's instanced draws, one batch per texture and vertex layout with anything visible
+    std::vector<FrameBatch> frameBatches;
+
+    SphereArrays worldSpheres;
+    std::vector<uint8_t> objectVisible;
+    // only counts cpu culling, the gpu pass doesn't report back
+    CullStats cullStats;
+
+    AssetCache<Mesh> meshCache;
+    AssetCache<Texture> textureCache;
+    AssetCache<VkSampler> samplerCache;
+
+    // assets whose last reference went away, one list per frame in flight
+    // the last frame submitted may still use them, so they go on its list and are destroyed once its fence is waited on
+    // and their upload has completed, anything still uploading stays on the list until the frame comes round again
+    struct RetiredAssets {
+        std::vector<Mesh> meshes;
+        std::vector<Texture> textures;
+    };
+    std::vector<RetiredAssets> retiredAssets;
+
+    FrameArena uniformArena;
+    FrameArena instanceArena;
+    FrameArena drawInputArena;
+
+    // where this frame's data starts in each arena
+    uint32_t uniformOffset = 0;
+    uint32_t cullUniformOffset = 0;
+    uint32_t instanceOffset = 0;
+    uint32_t drawInputOffset = 0;
+
+    // written by the culling pass, one region per frame in flight
+    // one instanced draw per mesh and texture, with its visible instances packed together
+    uint32_t drawCapacity = 0;
+    VkBuffer drawCommandBuffer;
+    Allocation drawCommandBufferAllocation;
+    VkDeviceSize drawCommandRegionSize;
+    VkBuffer visibleInstanceBuffer;
+    Allocation visibleInstanceBufferAllocation;
+    VkDeviceSize visibleInstanceRegionSize;
+
+    uint32_t drawCommandOffset = 0;
+    uint32_t visibleInstanceOffset = 0;
 
     VkDescriptorPool descriptorPool;
 
@@ -183,6 +317,25 @@ private:
     double lastY = 300;
 
     bool framebufferResized = false;
+    ResizeStats resizeStats;
+
+    bool headless = false;
+    HeadlessOptions headlessOptions;
+    // stand in for the swapchain images when headless
+    std::vector<Allocation> offscreenImageAllocations;
+    uint32_t lastImageIndex = 0;
+
+    // loaded in place of the default scene when set
+    const BenchmarkScript* benchmarkScript = nullptr;
+    double sceneLoadTime = 0.0;
+
+    // what loadScene created from the script, in order, for churnBenchmarkDrawables to replace
+    struct BenchmarkDrawable {
+        uint32_t handle;
+        const BenchmarkObjects* objects;
+    };
+    std::vector<BenchmarkDrawable> benchmarkDrawables;
+    size_t nextChurnedDrawable = 0;
 
     void initWindow();
 
@@ -194,6 +347,11 @@ private:
 
     void initVulkan();
 
+    void loadScene();
+
+    // replaces count drawables with copies created as their children, so destroying the originals reparents them
+    void churnBenchmarkDrawables(uint32_t count);
+
     void mainLoop();
 
     void cleanupSwapchain();
@@ -216,6 +374,15 @@ private:
 
     void createSwapchain();
 
+    void createOffscreenImages();
+
+    void destroyOffscreenImages();
+
+    void saveOffscreenImage(uint32_t imageIndex, const char* path);
+
+    // rgba8, whatever the offscreen format's channel order
+    void readOffscreenImage(uint32_t imageIndex, std::vector<uint8_t>& pixels);
+
     void createImageViews();
 
     void createRenderPass();
@@ -224,10 +391,20 @@ private:
 
     void createGraphicsPipeline();
 
+    void createCullPipeline();
+
     void createFramebuffers();
 
     void createCommandPool();
 
+    void createUploadManager();
+
+    void createGeometryPool();
+
+    void createOverlay();
+
+    void updateOverlay(std::chrono::high_resolution_clock::time_point frameStart);
+
     void createColorResources();
 
     void createDepthResources();
@@ -236,58 +413,75 @@ private:
 
     VkFormat findDepthFormat();
 
-    void createTextureImage(Drawable& object);
+    void createTextureImage(Texture& texture, const std::vector<char>& data);
 
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+    void generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
     VkSampleCountFlagBits getMaxUsableSampleCount();
 
-    void createTextureImageView(Drawable& object);
+    void createTextureImageView(Texture& texture);
 
-    void createTextureSampler(Drawable& object);
+    uint32_t acquireTextureSampler(uint32_t mipLevels);
 
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-
     void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling,
-                     VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+                     VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageAllocation);
+
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferAllocation);
+
+    uint32_t acquireMesh(const char* path, VertexLayout vertexLayout);
+
+    uint32_t acquireTexture(const char* path);
 
-    void transitionImageLayout(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+    void releaseMesh(uint32_t handle);
 
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void releaseTexture(uint32_t handle);
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    void releaseTextureSampler(uint32_t handle);
 
-    void loadModel(Drawable& object);
+    void destroyMesh(const Mesh& mesh);
 
-    void createVertexBuffer(Drawable& object);
+    void destroyTexture(Texture& texture);
 
-    void createIndexBuffer(Drawable& object);
+    size_t getLastSubmittedFrame() const;
 
-    void createUniformBuffers(Drawable& object);
+    // the frame's fence must have signalled, or the device be idle
+    void destroyRetiredAssets(size_t frameIndex, bool deviceIdle = false);
+
+    void createFrameArenas();
+
+    void reserveFrameArenas(size_t objectCount);
+
+    void createDrawCommandBuffers();
+
+    void destroyDrawCommandBuffers();
 
     void createDescriptorPool();
 
-    void createDescriptorSets(Drawable& object);
+    void createDescriptorSet(Texture& texture);
 
-    VkCommandBuffer beginSingleTimeCommands();
+    void updateDescriptorSet(const Texture& texture);
 
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+    void createCullDescriptorSet();
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    void updateCullDescriptorSet();
 
     void createCommandBuffers();
 
-    void recordCommandBuffer(uint32_t currentImage);
+    void recordCommandBuffer(uint32_t currentImage, uint32_t frameIndex);
+
+    void recordCulling(VkCommandBuffer commandBuffer);
+
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t first, uint32_t last) const;
 
     void createSyncObjects();
 
-    void updateUniformBuffer(uint32_t currentImage);
+    void updateUniformBuffer(uint32_t frameIndex);
 
-    void drawFrame();
+    void cullObjects(const Frustum& frustum);
 
-    void createDrawable(const char* texture, const char* model, void (*updateFunc)(Drawable* self));
+    void drawFrame();
 
     VkShaderModule createShaderModule(const std::vector<char>& code);
 
@@ -0,0 +1,66 @@
+#include "turt_frame_arena.h"
+
+#include <cstring>
+#include <stdexcept>
+
+void FrameArena::init(VkDevice deviceIn, MemoryAllocator* allocatorIn, VkBufferUsageFlags usageIn,
+                      VkDeviceSize alignmentIn, VkDeviceSize frameCapacityIn, uint32_t frameCountIn) {
+    device = deviceIn;
+    allocator = allocatorIn;
+    usage = usageIn;
+    alignment = alignmentIn > 0 ? alignmentIn : 1;
+    frameCapacity = alignSize(frameCapacityIn);
+    frameCount = frameCountIn;
+
+    createBuffer();
+}
+
+void FrameArena::cleanup() {
+    vkDestroyBuffer(device, buffer, nullptr);
+    allocator->free(allocation);
+    buffer = VK_NULL_HANDLE;
+}
+
+void FrameArena::resize(VkDeviceSize frameCapacityIn) {
+    cleanup();
+    frameCapacity = alignSize(frameCapacityIn);
+    frameStart = 0;
+    head = 0;
+    createBuffer();
+}
+
+void FrameArena::createBuffer() {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = frameCapacity * frameCount;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame arena buffer");
+    }
+
+    allocation = allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           false);
+}
+
+void FrameArena::beginFrame(uint32_t frameIndex) {
+    frameStart = frameCapacity * frameIndex;
+    head = frameStart;
+}
+
+uint32_t FrameArena::reserve(VkDeviceSize size) {
+    VkDeviceSize offset = head;
+    if (offset + size > frameStart + frameCapacity) {
+        throw std::runtime_error("frame arena is out of space");
+    }
+
+    head = offset + alignSize(size);
+    return static_cast<uint32_t>(offset);
+}
+
+uint32_t FrameArena::push(const void* data, VkDeviceSize size) {
+    uint32_t offset = reserve(size);
+    memcpy(static_cast<char*>(allocation.mapped) + offset, data, static_cast<size_t>(size));
+    return offset;
+}
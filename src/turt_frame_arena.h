@@ -0,0 +1,60 @@
+#pragma once
+
+#include "turt_allocator.h"
+
+// one persistently mapped buffer split into a region per frame in flight
+// per-frame data is bump allocated into the current region and addressed with dynamic offsets
+class FrameArena {
+public:
+    void init(VkDevice deviceIn, MemoryAllocator* allocatorIn, VkBufferUsageFlags usageIn, VkDeviceSize alignmentIn,
+              VkDeviceSize frameCapacityIn, uint32_t frameCountIn);
+
+    void cleanup();
+
+    void resize(VkDeviceSize frameCapacityIn);
+
+    void beginFrame(uint32_t frameIndex);
+
+    uint32_t push(const void* data, VkDeviceSize size);
+
+    template<typename T>
+    T* allocate(uint32_t& offset) {
+        offset = reserve(sizeof(T));
+        return reinterpret_cast<T*>(static_cast<char*>(allocation.mapped) + offset);
+    }
+
+    template<typename T>
+    T* allocateArray(uint32_t count, uint32_t& offset) {
+        offset = reserve(sizeof(T) * count);
+        return reinterpret_cast<T*>(static_cast<char*>(allocation.mapped) + offset);
+    }
+
+    VkDeviceSize alignSize(VkDeviceSize size) const {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    VkBuffer getBuffer() const { return buffer; }
+
+    VkDeviceSize getFrameCapacity() const { return frameCapacity; }
+
+    VkDeviceSize getBytesUsed() const { return head - frameStart; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Allocation allocation;
+
+    VkBufferUsageFlags usage = 0;
+    VkDeviceSize alignment = 1;
+    VkDeviceSize frameCapacity = 0;
+    uint32_t frameCount = 0;
+
+    VkDeviceSize frameStart = 0;
+    VkDeviceSize head = 0;
+
+    void createBuffer();
+
+    uint32_t reserve(VkDeviceSize size);
+};
@@ -0,0 +1,133 @@
+#include "turt_geometry.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+void GeometryPool::init(VkDevice deviceIn, MemoryAllocator* allocatorIn, UploadManager* uploadsIn,
+                        uint32_t vertexCapacity, uint32_t indexCapacity) {
+    device = deviceIn;
+    allocator = allocatorIn;
+    uploads = uploadsIn;
+    initialVertexCapacity = vertexCapacity;
+    initialIndexCapacity = indexCapacity;
+
+    // nothing is created yet, a layout no mesh uses never takes any memory
+    for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++) {
+        Stream& stream = vertexStreams[layout];
+        stream.unitSize = getVertexStride(static_cast<VertexLayout>(layout));
+        stream.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        stream.dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        stream.dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    }
+
+    indexStream.unitSize = 1;
+    indexStream.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    indexStream.dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    indexStream.dstAccess = VK_ACCESS_INDEX_READ_BIT;
+}
+
+void GeometryPool::cleanup() {
+    destroyStream(indexStream);
+    for (Stream& stream : vertexStreams) {
+        destroyStream(stream);
+    }
+}
+
+void GeometryPool::destroyStream(Stream& stream) {
+    if (stream.buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkDestroyBuffer(device, stream.buffer, nullptr);
+    allocator->free(stream.allocation);
+    stream.buffer = VK_NULL_HANDLE;
+    stream.ranges.reset();
+}
+
+VkBuffer GeometryPool::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Allocation& allocation) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    // a source as well, for growing into a larger buffer
+    bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create geometry buffer");
+    }
+
+    allocation = allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+    return buffer;
+}
+
+VkDeviceSize GeometryPool::allocateRange(Stream& stream, VkDeviceSize initialUnits, VkDeviceSize count,
+                                         VkDeviceSize alignment) {
+    if (stream.buffer == VK_NULL_HANDLE) {
+        // a mesh larger than the starting size gets a buffer its own size to begin with
+        VkDeviceSize units = std::max(initialUnits, count);
+        if (units > MAX_STREAM_UNITS) {
+            throw std::runtime_error("mesh is too large for the geometry pool");
+        }
+        stream.buffer = createBuffer(stream.unitSize * units, stream.usage, stream.allocation);
+        stream.ranges = std::make_unique<BlockMetadata>(units);
+    }
+
+    VkDeviceSize start;
+    while (!stream.ranges->allocate(count, alignment, start)) {
+        VkDeviceSize size = stream.ranges->getSize();
+        if (size >= MAX_STREAM_UNITS) {
+            throw std::runtime_error("geometry pool can't grow any further");
+        }
+        grow(stream, std::min(std::max(size * 2, size + count + alignment), MAX_STREAM_UNITS));
+    }
+    return start;
+}
+
+void GeometryPool::grow(Stream& stream, VkDeviceSize units) {
+    // uploads still recorded against the old buffer have to land first, and frames in flight may be reading it
+    uploads->wait(uploads->flush());
+    vkDeviceWaitIdle(device);
+
+    Allocation allocation;
+    VkBuffer buffer = createBuffer(stream.unitSize * units, stream.usage, allocation);
+    uploads->copyBuffer(stream.buffer, buffer, stream.unitSize * stream.ranges->getSize(), stream.dstStage,
+                        stream.dstAccess);
+    // uploads into the new space on a transfer queue could otherwise run before the copy and be overwritten by it
+    uploads->wait(uploads->flush());
+
+    vkDestroyBuffer(device, stream.buffer, nullptr);
+    allocator->free(stream.allocation);
+    stream.buffer = buffer;
+    stream.allocation = allocation;
+    stream.ranges->grow(units);
+}
+
+void GeometryPool::allocate(VertexLayout vertexLayout, const void* vertices, uint32_t vertexCount, VkIndexType indexType,
+                            const void* indices, uint32_t indexCount, uint32_t& vertexOffset, uint32_t& firstIndex) {
+    Stream& stream = vertexStreams[vertexLayout];
+    VkDeviceSize vertexStart = allocateRange(stream, initialVertexCapacity, vertexCount, 1);
+
+    VkDeviceSize indexSize = getIndexSize(indexType);
+    VkDeviceSize indexStart;
+    try {
+        indexStart = allocateRange(indexStream, sizeof(uint32_t) * static_cast<VkDeviceSize>(initialIndexCapacity),
+                                   indexSize * indexCount, indexSize);
+    } catch (...) {
+        stream.ranges->free(vertexStart);
+        throw;
+    }
+
+    vertexOffset = static_cast<uint32_t>(vertexStart);
+    firstIndex = static_cast<uint32_t>(indexStart / indexSize);
+
+    uploads->uploadBuffer(stream.buffer, stream.unitSize * vertexStart, vertices, stream.unitSize * vertexCount,
+                          stream.dstStage, stream.dstAccess);
+    uploads->uploadBuffer(indexStream.buffer, indexStart, indices, indexSize * indexCount, indexStream.dstStage,
+                          indexStream.dstAccess);
+}
+
+void GeometryPool::free(VertexLayout vertexLayout, VkIndexType indexType, uint32_t vertexOffset, uint32_t firstIndex) {
+    vertexStreams[vertexLayout].ranges->free(vertexOffset);
+    indexStream.ranges->free(static_cast<VkDeviceSize>(firstIndex) * getIndexSize(indexType));
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "turt_allocator.h"
+#include "turt_mesh.h"
+#include "turt_upload.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// one device local vertex buffer per vertex layout and one index buffer shared by every mesh
+// ranges are handed out in elements, so offsets can go straight into draw commands
+// 16 and 32 bit indices share the index buffer, each range is aligned to its own index size
+// buffers are created the first time something needs them and doubled when they run out, which waits for the device
+// and copies the old contents over, so buffers must be fetched again after every allocate()
+class GeometryPool {
+public:
+    // starting sizes, a layout's vertex buffer holds vertexCapacity vertices and indexCapacity counts 32 bit indices
+    void init(VkDevice deviceIn, MemoryAllocator* allocatorIn, UploadManager* uploadsIn, uint32_t vertexCapacity,
+              uint32_t indexCapacity);
+
+    void cleanup();
+
+    // copies the streams into the pool and returns where they landed
+    // vertices are laid out as vertexLayout says, see getVertexStride, and indices are indexType wide
+    // firstIndex counts indexType indices, so the buffer has to be bound with the same type to draw them
+    void allocate(VertexLayout vertexLayout, const void* vertices, uint32_t vertexCount, VkIndexType indexType,
+                  const void* indices, uint32_t indexCount, uint32_t& vertexOffset, uint32_t& firstIndex);
+
+    void free(VertexLayout vertexLayout, VkIndexType indexType, uint32_t vertexOffset, uint32_t firstIndex);
+
+    VkBuffer getVertexBuffer(VertexLayout vertexLayout) const { return vertexStreams[vertexLayout].buffer; }
+
+    VkBuffer getIndexBuffer() const { return indexStream.buffer; }
+
+private:
+    // a device local buffer and the ranges handed out of it, in whatever unit the ranges count
+    struct Stream {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation allocation;
+        std::unique_ptr<BlockMetadata> ranges;
+        // bytes per unit of ranges
+        VkDeviceSize unitSize = 1;
+        VkBufferUsageFlags usage = 0;
+        VkPipelineStageFlags dstStage = 0;
+        VkAccessFlags dstAccess = 0;
+    };
+
+    // offsets go into draw commands as 32 bit values, vertex offsets signed
+    static constexpr VkDeviceSize MAX_STREAM_UNITS = INT32_MAX;
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    UploadManager* uploads = nullptr;
+
+    uint32_t initialVertexCapacity = 0;
+    uint32_t initialIndexCapacity = 0;
+
+    std::array<Stream, VERTEX_LAYOUT_COUNT> vertexStreams;
+
+    // in bytes
+    Stream indexStream;
+
+    VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Allocation& allocation);
+
+    void destroyStream(Stream& stream);
+
+    // allocates count units, creating or growing the stream until they fit
+    VkDeviceSize allocateRange(Stream& stream, VkDeviceSize initialUnits, VkDeviceSize count, VkDeviceSize alignment);
+
+    void grow(Stream& stream, VkDeviceSize units);
+};
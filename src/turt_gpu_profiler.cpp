@@ -0,0 +1,176 @@
+#include "turt_gpu_profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice deviceIn, uint32_t graphicsFamily, bool hostQueryReset,
+                       uint32_t frameCountIn) {
+    device = deviceIn;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // differences are taken modulo the narrowest counter, so a wrap between two timestamps still comes out right
+    uint32_t validBits = 64;
+    timestampValidBits.resize(queueFamilyCount);
+    for (uint32_t i = 0; i < queueFamilyCount; i++) {
+        timestampValidBits[i] = queueFamilies[i].timestampValidBits;
+        if (timestampValidBits[i] > 0) {
+            validBits = std::min(validBits, timestampValidBits[i]);
+        }
+    }
+    timestampMask = validBits == 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+
+    enabled = hostQueryReset && timestampValidBits[graphicsFamily] > 0 && timestampPeriod > 0.0;
+    if (!enabled) {
+        return;
+    }
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = MAX_QUERIES_PER_FRAME;
+
+    frames.resize(frameCountIn);
+    for (Frame& frame : frames) {
+        if (vkCreateQueryPool(device, &poolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool");
+        }
+        vkResetQueryPool(device, frame.pool, 0, MAX_QUERIES_PER_FRAME);
+    }
+    currentFrame = 0;
+}
+
+void GpuProfiler::cleanup() {
+    for (Frame& frame : frames) {
+        vkDestroyQueryPool(device, frame.pool, nullptr);
+    }
+    frames.clear();
+    enabled = false;
+}
+
+bool GpuProfiler::isSupported(uint32_t queueFamily) const {
+    return enabled && queueFamily < timestampValidBits.size() && timestampValidBits[queueFamily] > 0;
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIndex) {
+    if (!enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    currentFrame = frameIndex;
+    Frame& frame = frames[frameIndex];
+
+    for (const Scope& scope : frame.scopes) {
+        if (!scope.ended) {
+            continue;
+        }
+
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(device, frame.pool, scope.query, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+            continue;
+        }
+
+        uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+        addSample(scope.name, ticks * timestampPeriod / 1000000.0);
+    }
+
+    if (frame.queryCount > 0) {
+        vkResetQueryPool(device, frame.pool, 0, frame.queryCount);
+    }
+    frame.scopes.clear();
+    frame.queryCount = 0;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name) {
+    if (!enabled) {
+        return NO_SCOPE;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Frame& frame = frames[currentFrame];
+    if (frame.queryCount + 2 > MAX_QUERIES_PER_FRAME) {
+        return NO_SCOPE;
+    }
+
+    Scope scope{ name, frame.queryCount, false };
+    frame.queryCount += 2;
+    frame.scopes.push_back(scope);
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, scope.query);
+    // the frame index tells endScope which pool, the scope index which query
+    return currentFrame * MAX_QUERIES_PER_FRAME + static_cast<uint32_t>(frame.scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+    if (scope == NO_SCOPE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Frame& frame = frames[scope / MAX_QUERIES_PER_FRAME];
+    // the frame was already read back, which only happens to a scope left open for a whole round of frames
+    if (scope % MAX_QUERIES_PER_FRAME >= frame.scopes.size()) {
+        return;
+    }
+    Scope& frameScope = frame.scopes[scope % MAX_QUERIES_PER_FRAME];
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, frameScope.query + 1);
+    frameScope.ended = true;
+}
+
+void GpuProfiler::addSample(const char* name, double milliseconds) {
+    size_t index = 0;
+    while (index < stats.size() && strcmp(stats[index].name, name) != 0) {
+        index++;
+    }
+    if (index == stats.size()) {
+        GpuScopeStats scopeStats;
+        scopeStats.name = name;
+        stats.push_back(scopeStats);
+        samples.emplace_back();
+    }
+
+    GpuScopeStats& scopeStats = stats[index];
+    std::vector<double>& window = samples[index];
+    if (window.size() < STATS_WINDOW) {
+        window.push_back(milliseconds);
+    } else {
+        window[scopeStats.sampleCount % STATS_WINDOW] = milliseconds;
+    }
+    scopeStats.sampleCount++;
+
+    scopeStats.last = milliseconds;
+    scopeStats.min = window[0];
+    scopeStats.max = window[0];
+    double total = 0.0;
+    for (double sample : window) {
+        scopeStats.min = std::min(scopeStats.min, sample);
+        scopeStats.max = std::max(scopeStats.max, sample);
+        total += sample;
+    }
+    scopeStats.average = total / window.size();
+}
+
+void GpuProfiler::writeCsv(const char* path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open gpu profile");
+    }
+
+    file << "scope,last_ms,min_ms,average_ms,max_ms,samples\n";
+    for (const GpuScopeStats& scopeStats : stats) {
+        file << scopeStats.name << "," << scopeStats.last << "," << scopeStats.min << "," << scopeStats.average << ","
+             << scopeStats.max << "," << scopeStats.sampleCount << "\n";
+    }
+}
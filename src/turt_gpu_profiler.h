@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct GpuScopeStats {
+    const char* name;
+    // milliseconds over the last STATS_WINDOW samples
+    double last = 0.0;
+    double min = 0.0;
+    double average = 0.0;
+    double max = 0.0;
+    uint32_t sampleCount = 0;
+};
+
+// times named scopes on the gpu with pairs of timestamp queries
+// each frame in flight has its own query pool, read back the next time its frame index comes around
+class GpuProfiler {
+public:
+    static constexpr uint32_t NO_SCOPE = UINT32_MAX;
+
+    // stays disabled when the device can't write timestamps from the graphics family or reset queries from the host
+    void init(VkPhysicalDevice physicalDevice, VkDevice deviceIn, uint32_t graphicsFamily, bool hostQueryReset,
+              uint32_t frameCountIn);
+
+    void cleanup();
+
+    bool isSupported(uint32_t queueFamily) const;
+
+    // reads back the scopes recorded the last time frameIndex was used, then recycles its queries
+    // everything recorded since then must have been submitted, so the read never waits on work that doesn't exist
+    void beginFrame(uint32_t frameIndex);
+
+    // name must outlive the profiler, scopes with the same name are tracked together
+    // returns NO_SCOPE when disabled or out of queries for this frame, which endScope ignores
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    const std::vector<GpuScopeStats>& getStats() const { return stats; }
+
+    void writeCsv(const char* path) const;
+
+private:
+    struct Scope {
+        const char* name;
+        // begin and end timestamps are query and query + 1
+        uint32_t query;
+        // a scope that was never ended has no end timestamp to wait for
+        bool ended;
+    };
+
+    struct Frame {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<Scope> scopes;
+        uint32_t queryCount = 0;
+    };
+
+    static constexpr uint32_t MAX_QUERIES_PER_FRAME = 256;
+    static constexpr uint32_t STATS_WINDOW = 120;
+
+    VkDevice device = VK_NULL_HANDLE;
+    bool enabled = false;
+    double timestampPeriod = 0.0;
+    uint64_t timestampMask = 0;
+    std::vector<uint32_t> timestampValidBits;
+
+    std::vector<Frame> frames;
+    uint32_t currentFrame = 0;
+    // uploads can record from other threads
+    std::mutex mutex;
+
+    std::vector<GpuScopeStats> stats;
+    // the last STATS_WINDOW samples of each scope in stats, as a ring
+    std::vector<std::vector<double>> samples;
+
+    void addSample(const char* name, double milliseconds);
+};
@@ -0,0 +1,119 @@
+#include "turt_jobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+uint32_t JobSystem::getDefaultWorkerCount() {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void JobSystem::init(uint32_t workerCount) {
+    stopping = false;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+void JobSystem::cleanup() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    jobs.clear();
+}
+
+void JobSystem::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    condition.notify_one();
+}
+
+void JobSystem::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+bool JobSystem::runPendingJob() {
+    std::function<void()> job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs.empty()) {
+            return false;
+        }
+
+        job = std::move(jobs.front());
+        jobs.pop_front();
+    }
+
+    job();
+    return true;
+}
+
+void JobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func) {
+    if (count == 0) {
+        return;
+    }
+
+    std::atomic<uint32_t> next{ 0 };
+    std::atomic<uint32_t> finishedHelpers{ 0 };
+    std::atomic<bool> failed{ false };
+    std::exception_ptr exception;
+
+    auto run = [&]() {
+        uint32_t i;
+        while (!failed.load(std::memory_order_relaxed) && (i = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+            try {
+                func(i);
+            } catch (...) {
+                if (!failed.exchange(true)) {
+                    exception = std::current_exception();
+                }
+            }
+        }
+    };
+
+    uint32_t helperCount = std::min(static_cast<uint32_t>(workers.size()), count - 1);
+    for (uint32_t i = 0; i < helperCount; i++) {
+        submit([&]() {
+            run();
+            finishedHelpers.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    run();
+
+    // helpers reference this stack frame, so wait for all of them even if they found no work
+    // helping with queued jobs meanwhile keeps nested calls from a worker from deadlocking
+    while (finishedHelpers.load(std::memory_order_acquire) < helperCount) {
+        if (!runPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed pool of worker threads pulling jobs from a shared queue
+class JobSystem {
+public:
+    // with zero workers, parallelFor runs everything on the calling thread
+    void init(uint32_t workerCount);
+
+    void cleanup();
+
+    // one worker per hardware thread besides the caller's
+    static uint32_t getDefaultWorkerCount();
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+    void submit(std::function<void()> job);
+
+    // calls func(i) for every i in [0, count) on the workers and the calling thread, returning once all calls are done
+    // the first exception thrown by func is rethrown here
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+
+    void workerLoop();
+
+    bool runPendingJob();
+};
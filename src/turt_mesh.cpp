@@ -0,0 +1,784 @@
+#include "turt_mesh.h"
+#include "turt_asset_cache.h"
+#include "turt_mesh_optimizer.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/gtx/hash.hpp>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace std {
+    template<>
+    struct hash<Vertex> {
+        size_t operator()(Vertex const& vertex) const {
+            return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+                   (hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+}
+
+const char* getVertexLayoutName(VertexLayout layout) {
+    return layout == VERTEX_LAYOUT_COMPACT ? "compact" : "mesh";
+}
+
+bool parseVertexLayout(const std::string& name, VertexLayout& layout) {
+    for (uint32_t i = 0; i < VERTEX_LAYOUT_COUNT; i++) {
+        if (name == getVertexLayoutName(static_cast<VertexLayout>(i))) {
+            layout = static_cast<VertexLayout>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t getVertexStride(VertexLayout layout) {
+    return layout == VERTEX_LAYOUT_COMPACT ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+VertexQuantization getVertexQuantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 extent = boundsMax - boundsMin;
+    float scale = std::max(extent.x, std::max(extent.y, extent.z));
+
+    // a single point still needs a scale to divide by
+    return { boundsMin, scale > 0.0f ? scale : 1.0f };
+}
+
+void compressVertices(const Vertex* vertices, uint32_t count, const VertexQuantization& quantization,
+                      CompactVertex* compact) {
+    float invScale = 1.0f / quantization.scale;
+    for (uint32_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float unit = (vertices[i].pos[axis] - quantization.offset[axis]) * invScale;
+            unit = std::min(std::max(unit, 0.0f), 1.0f);
+            compact[i].pos[axis] = static_cast<uint16_t>(std::lround(unit * 65535.0f));
+        }
+        compact[i].pos[3] = 0;
+        compact[i].texCoord = glm::packHalf2x16(vertices[i].texCoord);
+    }
+}
+
+Vertex decompressVertex(const CompactVertex& compact, const VertexQuantization& quantization) {
+    Vertex vertex{};
+    for (int axis = 0; axis < 3; axis++) {
+        vertex.pos[axis] = quantization.offset[axis] + compact.pos[axis] / 65535.0f * quantization.scale;
+    }
+    vertex.color = glm::vec3(1.0f);
+    vertex.texCoord = glm::unpackHalf2x16(compact.texCoord);
+    return vertex;
+}
+
+VkIndexType getIndexType(uint32_t vertexCount) {
+    return vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+uint32_t getIndexSize(VkIndexType indexType) {
+    return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void narrowIndices(const uint32_t* indices, uint32_t count, uint16_t* narrow) {
+    for (uint32_t i = 0; i < count; i++) {
+        narrow[i] = static_cast<uint16_t>(indices[i]);
+    }
+}
+
+static bool getSourceStamp(const char* path, uint64_t& size, int64_t& modified) {
+    std::error_code error;
+    size = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return false;
+    }
+
+    modified = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + MeshFileHeader::STREAM_ALIGNMENT - 1) / MeshFileHeader::STREAM_ALIGNMENT * MeshFileHeader::STREAM_ALIGNMENT;
+}
+
+void loadObjReference(const char* data, size_t size, MeshData& mesh) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string err;
+
+    std::istringstream stream(std::string(data, size));
+    tinyobj::MaterialFileReader materialReader("");
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, &stream, &materialReader)) {
+        throw std::runtime_error(err);
+    }
+
+    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+    mesh.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    mesh.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            Vertex vertex{};
+
+            vertex.pos = { attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1],
+                           attrib.vertices[3 * index.vertex_index + 2] };
+
+            vertex.texCoord = { attrib.texcoords[2 * index.texcoord_index + 0],
+                                1.0f - attrib.texcoords[2 * index.texcoord_index + 1] };
+
+            vertex.color = { 1.0f, 1.0f, 1.0f };
+
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(mesh.vertices.size());
+                mesh.vertices.push_back(vertex);
+
+                mesh.boundsMin = glm::min(mesh.boundsMin, vertex.pos);
+                mesh.boundsMax = glm::max(mesh.boundsMax, vertex.pos);
+            }
+
+            mesh.indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+}
+
+namespace {
+    const uint32_t INVALID_INDEX = UINT32_MAX;
+    const uint32_t DEDUP_SHARD_BITS = 6;
+    const uint32_t DEDUP_SHARD_COUNT = 1 << DEDUP_SHARD_BITS;
+    const size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+    struct ObjChunk {
+        const char* begin;
+        const char* end;
+
+        uint32_t positionCount = 0;
+        uint32_t texCoordCount = 0;
+        uint32_t positionBase = 0;
+        uint32_t texCoordBase = 0;
+
+        // triangulated face corners as indices into the global position and texcoord arrays
+        std::vector<uint32_t> cornerPositions;
+        std::vector<uint32_t> cornerTexCoords;
+        uint32_t cornerBase = 0;
+
+        // corner indices grouped by dedup shard, in file order within each shard
+        std::array<std::vector<uint32_t>, DEDUP_SHARD_COUNT> shardCorners;
+
+        uint32_t uniqueCount = 0;
+        uint32_t uniqueBase = 0;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* skipSpaces(const char* p, const char* end) {
+        while (p < end && isSpace(*p)) {
+            p++;
+        }
+        return p;
+    }
+
+    const char* nextLine(const char* p, const char* end) {
+        const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+        return newline != nullptr ? newline + 1 : end;
+    }
+
+    // correctly rounded to double like strtod, then narrowed to float as tinyobjloader does
+    float parseFloat(const char*& p, const char* end) {
+        static const double powersOfTen[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                              1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        const char* start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            p++;
+        }
+
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool exact = true;
+
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0) digits++;
+            } else {
+                exact = false;
+            }
+            p++;
+        }
+        if (p < end && *p == '.') {
+            p++;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    if (mantissa != 0) digits++;
+                    exponent--;
+                } else {
+                    exact = false;
+                }
+                p++;
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            const char* exponentStart = p;
+            p++;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negativeExponent = *p == '-';
+                p++;
+            }
+            if (p < end && *p >= '0' && *p <= '9') {
+                int value = 0;
+                while (p < end && *p >= '0' && *p <= '9') {
+                    value = std::min(value * 10 + (*p - '0'), 100000);
+                    p++;
+                }
+                exponent += negativeExponent ? -value : value;
+            } else {
+                p = exponentStart;
+            }
+        }
+
+        // a mantissa and power of ten that are both exact in a double round only once
+        if (exact && mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            double value = static_cast<double>(mantissa);
+            value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+            return static_cast<float>(negative ? -value : value);
+        }
+
+        // the mapping is not null terminated, so give strtod its own copy
+        char buffer[128];
+        size_t length = std::min(static_cast<size_t>(p - start), sizeof(buffer) - 1);
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        return static_cast<float>(strtod(buffer, nullptr));
+    }
+
+    int32_t parseInt(const char*& p, const char* end) {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            p++;
+        }
+
+        int32_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            p++;
+        }
+        return negative ? -value : value;
+    }
+
+    // obj indices are 1-based, or relative to the end of the list when negative
+    uint32_t resolveIndex(int32_t index, uint32_t count) {
+        if (index > 0) {
+            return static_cast<uint32_t>(index - 1);
+        }
+        if (index < 0 && static_cast<uint32_t>(-index) <= count) {
+            return count - static_cast<uint32_t>(-index);
+        }
+        return INVALID_INDEX;
+    }
+
+    void countChunk(ObjChunk& chunk) {
+        for (const char* p = chunk.begin; p < chunk.end; p = nextLine(p, chunk.end)) {
+            const char* token = skipSpaces(p, chunk.end);
+            if (chunk.end - token >= 2 && token[0] == 'v') {
+                if (isSpace(token[1])) {
+                    chunk.positionCount++;
+                } else if (token[1] == 't' && chunk.end - token >= 3 && isSpace(token[2])) {
+                    chunk.texCoordCount++;
+                }
+            }
+        }
+    }
+
+    void parseChunk(ObjChunk& chunk, std::vector<float>& positions, std::vector<float>& texCoords) {
+        uint32_t positionCount = chunk.positionBase;
+        uint32_t texCoordCount = chunk.texCoordBase;
+
+        std::vector<uint32_t> facePositions;
+        std::vector<uint32_t> faceTexCoords;
+
+        for (const char* line = chunk.begin; line < chunk.end;) {
+            const char* lineEnd = nextLine(line, chunk.end);
+            const char* p = skipSpaces(line, lineEnd);
+            line = lineEnd;
+
+            if (lineEnd - p < 2) {
+                continue;
+            }
+
+            if (p[0] == 'v' && isSpace(p[1])) {
+                p += 2;
+                for (int i = 0; i < 3; i++) {
+                    p = skipSpaces(p, lineEnd);
+                    positions[3 * positionCount + i] = parseFloat(p, lineEnd);
+                }
+                positionCount++;
+            } else if (p[0] == 'v' && p[1] == 't' && lineEnd - p >= 3 && isSpace(p[2])) {
+                p += 3;
+                for (int i = 0; i < 2; i++) {
+                    p = skipSpaces(p, lineEnd);
+                    texCoords[2 * texCoordCount + i] = parseFloat(p, lineEnd);
+                }
+                texCoordCount++;
+            } else if (p[0] == 'f' && isSpace(p[1])) {
+                p += 2;
+                facePositions.clear();
+                faceTexCoords.clear();
+
+                while (true) {
+                    p = skipSpaces(p, lineEnd);
+                    if (p >= lineEnd || *p == '\n' || *p == '#') {
+                        break;
+                    }
+
+                    uint32_t position = resolveIndex(parseInt(p, lineEnd), positionCount);
+                    uint32_t texCoord = INVALID_INDEX;
+                    if (p < lineEnd && *p == '/') {
+                        p++;
+                        if (p < lineEnd && *p != '/') {
+                            texCoord = resolveIndex(parseInt(p, lineEnd), texCoordCount);
+                        }
+                        if (p < lineEnd && *p == '/') {
+                            p++;
+                            parseInt(p, lineEnd);
+                        }
+                    }
+
+                    if (position == INVALID_INDEX) {
+                        throw std::runtime_error("obj face has an invalid vertex index");
+                    }
+
+                    facePositions.push_back(position);
+                    faceTexCoords.push_back(texCoord);
+
+                    while (p < lineEnd && !isSpace(*p) && *p != '\n') {
+                        p++;
+                    }
+                }
+
+                // polygons become triangle fans, as tinyobjloader triangulates them
+                for (size_t i = 2; i < facePositions.size(); i++) {
+                    size_t corners[] = { 0, i - 1, i };
+                    for (size_t corner : corners) {
+                        chunk.cornerPositions.push_back(facePositions[corner]);
+                        chunk.cornerTexCoords.push_back(faceTexCoords[corner]);
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t hashFloat(uint64_t hash, float value) {
+        // -0 and +0 compare equal, so they must hash the same
+        value += 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        hash ^= bits;
+        hash *= 0x100000001b3ull;
+        return hash;
+    }
+
+    uint64_t hashVertex(const Vertex& vertex) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        hash = hashFloat(hash, vertex.pos.x);
+        hash = hashFloat(hash, vertex.pos.y);
+        hash = hashFloat(hash, vertex.pos.z);
+        hash = hashFloat(hash, vertex.color.x);
+        hash = hashFloat(hash, vertex.color.y);
+        hash = hashFloat(hash, vertex.color.z);
+        hash = hashFloat(hash, vertex.texCoord.x);
+        hash = hashFloat(hash, vertex.texCoord.y);
+        // fold the high bits down since both the shard and the slot come from this
+        return hash ^ (hash >> 29);
+    }
+}
+
+void loadObj(const char* data, size_t size, MeshData& mesh, JobSystem& jobs) {
+    // split at line boundaries, a few chunks per thread to even out the load
+    size_t chunkSize = std::max(MIN_CHUNK_SIZE, size / (jobs.getThreadCount() * 4) + 1);
+    std::vector<ObjChunk> chunks;
+    for (const char* p = data; p < data + size;) {
+        const char* end = p + std::min(chunkSize, static_cast<size_t>(data + size - p));
+        if (end < data + size) {
+            end = nextLine(end, data + size);
+        }
+
+        ObjChunk chunk;
+        chunk.begin = p;
+        chunk.end = end;
+        chunks.push_back(std::move(chunk));
+        p = end;
+    }
+    uint32_t chunkCount = static_cast<uint32_t>(chunks.size());
+
+    jobs.parallelFor(chunkCount, [&](uint32_t i) { countChunk(chunks[i]); });
+
+    uint32_t positionCount = 0;
+    uint32_t texCoordCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.positionBase = positionCount;
+        chunk.texCoordBase = texCoordCount;
+        positionCount += chunk.positionCount;
+        texCoordCount += chunk.texCoordCount;
+    }
+
+    std::vector<float> positions(3 * size_t(positionCount));
+    std::vector<float> texCoords(2 * size_t(texCoordCount));
+    jobs.parallelFor(chunkCount, [&](uint32_t i) { parseChunk(chunks[i], positions, texCoords); });
+
+    uint32_t cornerCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.cornerBase = cornerCount;
+        cornerCount += static_cast<uint32_t>(chunk.cornerPositions.size());
+    }
+
+    // build every corner's vertex and sort it into a shard by hash
+    std::vector<Vertex> corners(cornerCount);
+    std::vector<uint64_t> hashes(cornerCount);
+    jobs.parallelFor(chunkCount, [&](uint32_t i) {
+        ObjChunk& chunk = chunks[i];
+        for (size_t j = 0; j < chunk.cornerPositions.size(); j++) {
+            uint32_t position = chunk.cornerPositions[j];
+            uint32_t texCoord = chunk.cornerTexCoords[j];
+            if (position >= positionCount || (texCoord != INVALID_INDEX && texCoord >= texCoordCount)) {
+                throw std::runtime_error("obj face has an invalid vertex index");
+            }
+
+            Vertex vertex{};
+            vertex.pos = { positions[3 * size_t(position) + 0], positions[3 * size_t(position) + 1],
+                           positions[3 * size_t(position) + 2] };
+            if (texCoord != INVALID_INDEX) {
+                vertex.texCoord = { texCoords[2 * size_t(texCoord) + 0], 1.0f - texCoords[2 * size_t(texCoord) + 1] };
+            }
+            vertex.color = { 1.0f, 1.0f, 1.0f };
+
+            uint32_t corner = chunk.cornerBase + static_cast<uint32_t>(j);
+            corners[corner] = vertex;
+            hashes[corner] = hashVertex(vertex);
+            chunk.shardCorners[hashes[corner] >> (64 - DEDUP_SHARD_BITS)].push_back(corner);
+        }
+
+        chunk.cornerPositions = std::vector<uint32_t>();
+        chunk.cornerTexCoords = std::vector<uint32_t>();
+    });
+
+    // each shard owns its own open addressing table, so no locking is needed
+    // visiting corners in file order means the first occurrence of each vertex wins, as in the serial loader
+    std::vector<uint32_t> firstCorners(cornerCount);
+    jobs.parallelFor(DEDUP_SHARD_COUNT, [&](uint32_t shard) {
+        size_t shardSize = 0;
+        for (const ObjChunk& chunk : chunks) {
+            shardSize += chunk.shardCorners[shard].size();
+        }
+
+        size_t capacity = 16;
+        while (capacity < shardSize * 2) {
+            capacity *= 2;
+        }
+        std::vector<uint32_t> table(capacity, INVALID_INDEX);
+
+        for (const ObjChunk& chunk : chunks) {
+            for (uint32_t corner : chunk.shardCorners[shard]) {
+                size_t slot = hashes[corner] & (capacity - 1);
+                while (true) {
+                    uint32_t existing = table[slot];
+                    if (existing == INVALID_INDEX) {
+                        table[slot] = corner;
+                        firstCorners[corner] = corner;
+                        break;
+                    }
+                    if (corners[existing] == corners[corner]) {
+                        firstCorners[corner] = existing;
+                        break;
+                    }
+                    slot = (slot + 1) & (capacity - 1);
+                }
+            }
+        }
+    });
+
+    auto chunkCornerEnd = [&](uint32_t i) {
+        return i + 1 < chunkCount ? chunks[i + 1].cornerBase : cornerCount;
+    };
+
+    // number the unique vertices in order of first appearance
+    jobs.parallelFor(chunkCount, [&](uint32_t i) {
+        for (uint32_t corner = chunks[i].cornerBase; corner < chunkCornerEnd(i); corner++) {
+            if (firstCorners[corner] == corner) {
+                chunks[i].uniqueCount++;
+            }
+        }
+    });
+
+    uint32_t vertexCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.uniqueBase = vertexCount;
+        vertexCount += chunk.uniqueCount;
+    }
+
+    mesh.vertices.resize(vertexCount);
+    mesh.indices.resize(cornerCount);
+    std::vector<uint32_t> vertexIds(cornerCount);
+
+    jobs.parallelFor(chunkCount, [&](uint32_t i) {
+        ObjChunk& chunk = chunks[i];
+        chunk.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        chunk.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+        uint32_t vertexId = chunk.uniqueBase;
+        for (uint32_t corner = chunk.cornerBase; corner < chunkCornerEnd(i); corner++) {
+            if (firstCorners[corner] == corner) {
+                vertexIds[corner] = vertexId;
+                mesh.vertices[vertexId] = corners[corner];
+                chunk.boundsMin = glm::min(chunk.boundsMin, corners[corner].pos);
+                chunk.boundsMax = glm::max(chunk.boundsMax, corners[corner].pos);
+                vertexId++;
+            }
+        }
+    });
+
+    jobs.parallelFor(chunkCount, [&](uint32_t i) {
+        for (uint32_t corner = chunks[i].cornerBase; corner < chunkCornerEnd(i); corner++) {
+            mesh.indices[corner] = vertexIds[firstCorners[corner]];
+        }
+    });
+
+    mesh.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    mesh.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const ObjChunk& chunk : chunks) {
+        mesh.boundsMin = glm::min(mesh.boundsMin, chunk.boundsMin);
+        mesh.boundsMax = glm::max(mesh.boundsMax, chunk.boundsMax);
+    }
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const char* path) {
+    close();
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        close();
+        return false;
+    }
+
+    data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+
+    data = nullptr;
+    size = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+#else
+bool MappedFile::open(const char* path) {
+    close();
+
+    fileDescriptor = ::open(path, O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0) {
+        close();
+        return false;
+    }
+    size = static_cast<size_t>(fileStat.st_size);
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return false;
+    }
+    data = static_cast<const char*>(mapping);
+
+    // the whole file is about to be copied into a staging buffer
+    madvise(mapping, size, MADV_WILLNEED);
+
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+    if (fileDescriptor >= 0) {
+        ::close(fileDescriptor);
+    }
+
+    data = nullptr;
+    size = 0;
+    fileDescriptor = -1;
+}
+#endif
+
+bool MeshFile::open(const char* path, const char* sourcePath) {
+    header = nullptr;
+
+    if (!file.open(path) || file.getSize() < sizeof(MeshFileHeader)) {
+        return false;
+    }
+
+    const MeshFileHeader* fileHeader = reinterpret_cast<const MeshFileHeader*>(file.getData());
+    if (fileHeader->magic != MeshFileHeader::MAGIC || fileHeader->version != MeshFileHeader::VERSION ||
+        fileHeader->vertexStride != sizeof(Vertex) || fileHeader->indexSize != getIndexSize(getIndexType(fileHeader->vertexCount))) {
+        file.close();
+        return false;
+    }
+
+    uint64_t vertexEnd = fileHeader->vertexOffset + uint64_t(fileHeader->vertexCount) * fileHeader->vertexStride;
+    uint64_t indexEnd = fileHeader->indexOffset + uint64_t(fileHeader->indexCount) * fileHeader->indexSize;
+    if (vertexEnd > file.getSize() || indexEnd > file.getSize()) {
+        file.close();
+        return false;
+    }
+
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    if (getSourceStamp(sourcePath, sourceSize, sourceModified) &&
+        (sourceSize != fileHeader->sourceSize || sourceModified != fileHeader->sourceModified)) {
+        file.close();
+        return false;
+    }
+
+    header = fileHeader;
+    return true;
+}
+
+std::string getBakedMeshPath(const char* sourcePath) {
+    return std::filesystem::path(sourcePath).replace_extension(".tmesh").string();
+}
+
+void bakeMesh(const char* sourcePath, const char* meshPath, JobSystem& jobs, MeshOptimizationStats* stats) {
+    MappedFile source;
+    if (!source.open(sourcePath)) {
+        throw std::runtime_error("failed to open mesh source");
+    }
+
+    MeshData mesh;
+    loadObj(source.getData(), source.getSize(), mesh, jobs);
+
+    MeshOptimizationStats optimizationStats = optimizeMesh(mesh);
+    if (stats != nullptr) {
+        *stats = optimizationStats;
+    }
+
+    MeshFileHeader header{};
+    header.magic = MeshFileHeader::MAGIC;
+    header.version = MeshFileHeader::VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    VkIndexType indexType = getIndexType(header.vertexCount);
+    header.indexSize = getIndexSize(indexType);
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.vertexOffset = alignOffset(sizeof(MeshFileHeader));
+    header.indexOffset = alignOffset(header.vertexOffset + mesh.vertices.size() * sizeof(Vertex));
+    header.sourceHash = hashBytes(source.getData(), source.getSize());
+    getSourceStamp(sourcePath, header.sourceSize, header.sourceModified);
+
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+
+    std::vector<char> contents(header.indexOffset + mesh.indices.size() * header.indexSize);
+    memcpy(contents.data(), &header, sizeof(header));
+    memcpy(contents.data() + header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+    if (indexType == VK_INDEX_TYPE_UINT16) {
+        narrowIndices(mesh.indices.data(), header.indexCount, reinterpret_cast<uint16_t*>(contents.data() + header.indexOffset));
+    } else {
+        memcpy(contents.data() + header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    }
+
+    // written beside the real path and renamed over it, so an interrupted bake never leaves a truncated file
+    std::string tempPath = std::string(meshPath) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to create baked mesh file");
+        }
+
+        file.write(contents.data(), contents.size());
+        if (!file) {
+            throw std::runtime_error("failed to write baked mesh file");
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, meshPath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        throw std::runtime_error("failed to replace baked mesh file");
+    }
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include "turt_jobs.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum VertexLayout : uint32_t {
+    // Vertex
+    VERTEX_LAYOUT_MESH,
+    // CompactVertex
+    VERTEX_LAYOUT_COMPACT,
+    VERTEX_LAYOUT_COUNT,
+};
+
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 color;
+    glm::vec2 texCoord;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(Vertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+
+        return attributeDescriptions;
+    }
+
+    bool operator==(const Vertex& other) const {
+        return pos == other.pos && color == other.color && texCoord == other.texCoord;
+    }
+};
+
+// 12 bytes against Vertex's 32, the constant vertex color is dropped
+// positions are 16 bit unorm inside the mesh's quantization cube, decoded with VertexQuantization
+struct CompactVertex {
+    // w is padding, it keeps texCoord aligned and the format one every device can fetch
+    uint16_t pos[4];
+    // two half floats, uvs can leave [0, 1] so they aren't normalized
+    uint32_t texCoord;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(CompactVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    // same locations as Vertex minus the color
+    static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{};
+
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(CompactVertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 2;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(CompactVertex, texCoord);
+
+        return attributeDescriptions;
+    }
+};
+
+// a compact position p in [0, 1] is offset + p * scale in mesh space
+// the scale is the same on every axis, so the decode is a uniform scale that bounding spheres survive
+struct VertexQuantization {
+    glm::vec3 offset;
+    float scale;
+};
+
+// "mesh" or "compact"
+const char* getVertexLayoutName(VertexLayout layout);
+
+// false if name isn't one getVertexLayoutName returns
+bool parseVertexLayout(const std::string& name, VertexLayout& layout);
+
+uint32_t getVertexStride(VertexLayout layout);
+
+VertexQuantization getVertexQuantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+void compressVertices(const Vertex* vertices, uint32_t count, const VertexQuantization& quantization,
+                      CompactVertex* compact);
+
+// back to mesh space, only used to measure the error
+Vertex decompressVertex(const CompactVertex& compact, const VertexQuantization& quantization);
+
+// primitive restart is never enabled, so 0xffff is an ordinary index and 65536 vertices still fit in 16 bits
+VkIndexType getIndexType(uint32_t vertexCount);
+
+uint32_t getIndexSize(VkIndexType indexType);
+
+// every index has to be below 65536
+void narrowIndices(const uint32_t* indices, uint32_t count, uint16_t* narrow);
+
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+// parses obj text in chunks across the job system, merging identical vertices
+// the output is the same regardless of thread count and matches loadObjReference
+void loadObj(const char* data, size_t size, MeshData& mesh, JobSystem& jobs);
+
+// single threaded tinyobjloader path
+void loadObjReference(const char* data, size_t size, MeshData& mesh);
+
+// layout of a baked .tmesh file: this header followed by the vertex and index streams at the given offsets
+struct MeshFileHeader {
+    static constexpr uint32_t MAGIC = 0x48534d54; // "TMSH"
+    // 2: triangles and vertices are stored in optimizeMesh's order
+    // 3: indices are 16 bit when the vertex count allows, see getIndexType
+    static constexpr uint32_t VERSION = 3;
+    static constexpr uint64_t STREAM_ALIGNMENT = 16;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t indexSize;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+
+    // used to tell when the source obj has changed since the bake
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t sourceHash;
+
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    bool open(const char* path);
+
+    void close();
+
+    const char* getData() const { return data; }
+
+    size_t getSize() const { return size; }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+
+// a baked mesh mapped into memory, its streams can be copied straight into staging buffers
+class MeshFile {
+public:
+    // fails if the file is missing, malformed, from another version, or out of date with its source
+    bool open(const char* path, const char* sourcePath);
+
+    const MeshFileHeader& getHeader() const { return *header; }
+
+    const Vertex* getVertices() const { return reinterpret_cast<const Vertex*>(file.getData() + header->vertexOffset); }
+
+    // indexSize bytes each
+    const void* getIndices() const { return file.getData() + header->indexOffset; }
+
+private:
+    MappedFile file;
+    const MeshFileHeader* header = nullptr;
+};
+
+std::string getBakedMeshPath(const char* sourcePath);
+
+struct MeshOptimizationStats;
+
+// parses the obj at sourcePath, reorders it with optimizeMesh and writes it out as a .tmesh
+void bakeMesh(const char* sourcePath, const char* meshPath, JobSystem& jobs, MeshOptimizationStats* stats = nullptr);
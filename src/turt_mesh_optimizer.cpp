@@ -0,0 +1,284 @@
+#include "turt_mesh_optimizer.h"
+
+#include <algorithm>
+#include <limits>
+
+static constexpr uint32_t CACHE_SIZE = 16;
+static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+static constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+// the caches below are timestamps instead of queues: a vertex is in the fifo if it was pushed within the last
+// cacheSize misses, and moving time forward by more than cacheSize empties the whole cache at once
+static bool cacheMiss(std::vector<uint32_t>& cacheTime, uint32_t& time, uint32_t cacheSize, uint32_t vertex) {
+    if (time - cacheTime[vertex] > cacheSize) {
+        cacheTime[vertex] = time;
+        time++;
+        return true;
+    }
+    return false;
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty()) {
+        return stats;
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    uint32_t usedCount = 0;
+
+    for (uint32_t index : indices) {
+        misses += cacheMiss(cacheTime, time, cacheSize, index);
+        if (!used[index]) {
+            used[index] = true;
+            usedCount++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / usedCount;
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize,
+                         std::vector<uint32_t>& clusters) {
+    size_t triangleCount = indices.size() / 3;
+    clusters.clear();
+
+    // triangles not emitted yet per vertex
+    std::vector<uint32_t> liveCount(vertexCount, 0);
+    for (uint32_t index : indices) {
+        liveCount[index]++;
+    }
+
+    // the triangles around each vertex, packed into one array
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveCount[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    std::vector<bool> emitted(triangleCount, false);
+
+    // recently emitted vertices to fall back to once the current fan runs out of neighbours
+    std::vector<uint32_t> deadEnds;
+    deadEnds.reserve(indices.size());
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    uint32_t cursor = 0;
+
+    auto skipDeadEnd = [&]() {
+        while (!deadEnds.empty()) {
+            uint32_t vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveCount[vertex] > 0) {
+                return vertex;
+            }
+        }
+        for (; cursor < vertexCount; cursor++) {
+            if (liveCount[cursor] > 0) {
+                return cursor;
+            }
+        }
+        return NO_VERTEX;
+    };
+
+    uint32_t fanning = skipDeadEnd();
+    if (fanning != NO_VERTEX) {
+        clusters.push_back(0);
+    }
+
+    while (fanning != NO_VERTEX) {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t vertex = indices[triangle * 3 + k];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveCount[vertex]--;
+                cacheMiss(cacheTime, time, cacheSize, vertex);
+            }
+            emitted[triangle] = true;
+        }
+
+        // fan next around the oldest candidate that will still be cached once its own fan is emitted,
+        // any live candidate beats leaving the neighbourhood
+        uint32_t next = NO_VERTEX;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveCount[vertex] == 0) {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveCount[vertex] <= cacheSize) {
+                priority = time - cacheTime[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+
+        if (next == NO_VERTEX) {
+            next = skipDeadEnd();
+            if (next != NO_VERTEX) {
+                clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+            }
+        }
+        fanning = next;
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t cacheSize,
+                      const std::vector<uint32_t>& clusters, float threshold) {
+    uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+
+    std::vector<uint32_t> cacheTime(vertices.size(), 0);
+    uint32_t time = cacheSize + 1;
+
+    auto triangleMisses = [&](uint32_t triangle) {
+        uint32_t misses = 0;
+        for (uint32_t k = 0; k < 3; k++) {
+            misses += cacheMiss(cacheTime, time, cacheSize, indices[triangle * 3 + k]);
+        }
+        return misses;
+    };
+
+    // smaller clusters sort better, but each split starts the cache cold again
+    std::vector<uint32_t> starts;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        uint32_t begin = clusters[c];
+        uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        time += cacheSize + 1;
+        uint32_t misses = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            misses += triangleMisses(t);
+        }
+        float clusterThreshold = static_cast<float>(misses) / (end - begin) * threshold;
+
+        time += cacheSize + 1;
+        starts.push_back(begin);
+        uint32_t start = begin;
+        misses = 0;
+        for (uint32_t t = begin; t < end; t++) {
+            misses += triangleMisses(t);
+            if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= clusterThreshold) {
+                starts.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                time += cacheSize + 1;
+            }
+        }
+    }
+
+    // area weighted, so long thin slivers don't pull the center around
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCenters(starts.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(starts.size(), glm::vec3(0.0f));
+    std::vector<float> clusterAreas(starts.size(), 0.0f);
+
+    for (size_t cluster = 0; cluster < starts.size(); cluster++) {
+        uint32_t end = cluster + 1 < starts.size() ? starts[cluster + 1] : triangleCount;
+        for (uint32_t t = starts[cluster]; t < end; t++) {
+            const glm::vec3& a = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& c = vertices[indices[t * 3 + 2]].pos;
+
+            // twice the area along the face normal
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            glm::vec3 center = (a + b + c) / 3.0f;
+
+            clusterNormals[cluster] += normal;
+            clusterCenters[cluster] += center * area;
+            clusterAreas[cluster] += area;
+            meshCenter += center * area;
+            meshArea += area;
+        }
+    }
+    if (meshArea > 0.0f) {
+        meshCenter /= meshArea;
+    }
+
+    // clusters far out along their own normal are the likely occluders of a convex-ish mesh
+    std::vector<float> sortKeys(starts.size(), 0.0f);
+    for (size_t c = 0; c < starts.size(); c++) {
+        float normalLength = glm::length(clusterNormals[c]);
+        if (clusterAreas[c] > 0.0f && normalLength > 0.0f) {
+            glm::vec3 center = clusterCenters[c] / clusterAreas[c];
+            sortKeys[c] = glm::dot(center - meshCenter, clusterNormals[c] / normalLength);
+        }
+    }
+
+    std::vector<uint32_t> order(starts.size());
+    for (uint32_t c = 0; c < order.size(); c++) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (uint32_t c : order) {
+        uint32_t end = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+        output.insert(output.end(), indices.begin() + starts[c] * 3, indices.begin() + end * 3);
+    }
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+    std::vector<Vertex> output;
+    output.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = static_cast<uint32_t>(output.size());
+            output.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(output);
+}
+
+MeshOptimizationStats optimizeMesh(MeshData& mesh) {
+    MeshOptimizationStats stats;
+    uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    stats.before = analyzeVertexCache(mesh.indices, vertexCount, CACHE_SIZE);
+
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(mesh.indices, vertexCount, CACHE_SIZE, clusters);
+    stats.afterVertexCache = analyzeVertexCache(mesh.indices, vertexCount, CACHE_SIZE);
+
+    optimizeOverdraw(mesh.indices, mesh.vertices, CACHE_SIZE, clusters, OVERDRAW_THRESHOLD);
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+    stats.after = analyzeVertexCache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()), CACHE_SIZE);
+
+    return stats;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "turt_mesh.h"
+
+#include <cstdint>
+#include <vector>
+
+// triangle and vertex reordering for the gpu's post-transform cache, overdraw and vertex fetch
+// everything here is plain cpu work on MeshData's streams, the triangles drawn never change, only their order
+
+struct VertexCacheStats {
+    // vertices transformed per triangle, 3 means no reuse at all and about 0.5 is the floor for a regular grid
+    float acmr = 0.0f;
+    // vertices transformed per vertex used, 1 means every vertex was transformed once
+    float atvr = 0.0f;
+};
+
+// simulates a fifo post-transform cache of cacheSize entries over the index buffer
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize);
+
+// tipsy (sander, nehab and barczak, "fast triangle reordering for vertex locality and reduced overdraw")
+// reorders triangles in place and fills clusters with the first triangle of each run the cache had to restart
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize,
+                         std::vector<uint32_t>& clusters);
+
+// splits the clusters from optimizeVertexCache wherever the cache has warmed up to within threshold of the whole
+// cluster's acmr, then sorts them so the ones facing away from the mesh's center draw first and hide what's behind
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t cacheSize,
+                      const std::vector<uint32_t>& clusters, float threshold);
+
+// renumbers vertices in the order the indices first use them, dropping any that are never used
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats afterVertexCache;
+    // the overdraw pass gives back a little of the cache gain
+    VertexCacheStats after;
+};
+
+// all three passes in order, with a 16 entry cache and a 1.05 overdraw threshold
+MeshOptimizationStats optimizeMesh(MeshData& mesh);
@@ -0,0 +1,243 @@
+#include "turt_overlay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+static void checkOverlayResult(VkResult result) {
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("imgui vulkan backend call failed");
+    }
+}
+
+void Overlay::init(GLFWwindow* window, VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice deviceIn,
+                   uint32_t queueFamily, VkQueue queueIn, VkPipelineCache pipelineCache, VkRenderPass renderPass,
+                   VkSampleCountFlagBits msaaSamples, uint32_t frameCountIn, GpuProfiler* profilerIn) {
+    device = deviceIn;
+    queue = queueIn;
+    profiler = profilerIn;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    // one font atlas, nothing else samples
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create overlay descriptor pool");
+    }
+
+    VkCommandPoolCreateInfo commandPoolInfo{};
+    commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolInfo.queueFamilyIndex = queueFamily;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = 1;
+
+    frames.resize(frameCountIn);
+    for (Frame& frame : frames) {
+        if (vkCreateCommandPool(device, &commandPoolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create overlay command pool");
+        }
+
+        allocInfo.commandPool = frame.pool;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &frame.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate overlay command buffer");
+        }
+    }
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::StyleColorsDark();
+    ImGui::GetIO().IniFilename = nullptr;
+
+    // the overlay takes no input, the engine keeps the mouse for the camera
+    ImGui_ImplGlfw_InitForVulkan(window, false);
+
+    // the backend cycles its vertex buffers once per rendered frame, so one per frame in flight is enough
+    initInfo.Instance = instance;
+    initInfo.PhysicalDevice = physicalDevice;
+    initInfo.Device = device;
+    initInfo.QueueFamily = queueFamily;
+    initInfo.Queue = queue;
+    initInfo.PipelineCache = pipelineCache;
+    initInfo.DescriptorPool = descriptorPool;
+    initInfo.Subpass = 0;
+    initInfo.MinImageCount = std::max(frameCountIn, 2u);
+    initInfo.ImageCount = initInfo.MinImageCount;
+    initInfo.MSAASamples = msaaSamples;
+    initInfo.CheckVkResultFn = checkOverlayResult;
+
+    ImGui_ImplVulkan_Init(&initInfo, renderPass);
+    uploadFonts();
+}
+
+void Overlay::cleanup() {
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
+    for (Frame& frame : frames) {
+        vkDestroyCommandPool(device, frame.pool, nullptr);
+    }
+    frames.clear();
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+}
+
+void Overlay::setRenderPass(VkRenderPass renderPass) {
+    // shutting down frees the font atlas too
+    ImGui_ImplVulkan_Shutdown();
+    ImGui_ImplVulkan_Init(&initInfo, renderPass);
+    uploadFonts();
+}
+
+void Overlay::uploadFonts() {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = frames[0].pool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate overlay upload command buffer");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    ImGui_ImplVulkan_CreateFontsTexture(commandBuffer);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    // only happens at startup and when the swapchain format changes, waiting is fine
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit overlay font upload");
+    }
+    vkQueueWaitIdle(queue);
+
+    vkFreeCommandBuffers(device, frames[0].pool, 1, &commandBuffer);
+    ImGui_ImplVulkan_DestroyFontUploadObjects();
+}
+
+void Overlay::update(const OverlayStats& stats) {
+    if (!visible) {
+        return;
+    }
+
+    frameHistory[historyOffset] = static_cast<float>(stats.frameInterval);
+    gpuHistory[historyOffset] = static_cast<float>(std::max(stats.gpuTime, 0.0));
+    historyOffset = (historyOffset + 1) % HISTORY_SIZE;
+
+    ImGui_ImplVulkan_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_Always);
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    ImGui::Begin("stats", nullptr,
+                 ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+                 ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoInputs);
+
+    // both graphs share a scale so they can be compared at a glance
+    float scaleMax = 1.0f;
+    for (uint32_t i = 0; i < HISTORY_SIZE; i++) {
+        scaleMax = std::max(scaleMax, std::max(frameHistory[i], gpuHistory[i]));
+    }
+
+    char text[64];
+    double fps = stats.frameInterval > 0.0 ? 1000.0 / stats.frameInterval : 0.0;
+    snprintf(text, sizeof(text), "frame %.2f ms (%.0f fps)", stats.frameInterval, fps);
+    ImGui::PlotLines("##frame", frameHistory, HISTORY_SIZE, historyOffset, text, 0.0f, scaleMax, ImVec2(240.0f, 40.0f));
+    ImGui::Text("cpu %.3f ms", stats.cpuTime);
+
+    if (stats.gpuTime >= 0.0) {
+        snprintf(text, sizeof(text), "gpu %.3f ms", stats.gpuTime);
+        ImGui::PlotLines("##gpu", gpuHistory, HISTORY_SIZE, historyOffset, text, 0.0f, scaleMax, ImVec2(240.0f, 40.0f));
+    } else {
+        ImGui::TextDisabled("gpu timestamps unavailable");
+    }
+
+    ImGui::Separator();
+    ImGui::Text("%u draws, %llu triangles", stats.drawCount, static_cast<unsigned long long>(stats.triangleCount));
+    if (stats.cpuCulling) {
+        ImGui::Text("%u objects, %u visible, %u culled", stats.objectCount, stats.cullStats.visibleCount,
+                    stats.cullStats.culledCount);
+    } else {
+        ImGui::Text("%u objects, culled on the gpu", stats.objectCount);
+    }
+    ImGui::Text("uploads %.2f MB/s", stats.uploadBandwidth / (1024.0 * 1024.0));
+
+    ImGui::Separator();
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        const VkMemoryHeap& heap = memoryProperties.memoryHeaps[i];
+        double used = stats.memoryStats.heapBytesAllocated[i] / (1024.0 * 1024.0);
+        double size = heap.size / (1024.0 * 1024.0);
+
+        bool deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        snprintf(text, sizeof(text), "heap %u%s: %.1f / %.0f MB", i, deviceLocal ? " (device)" : "", used, size);
+        ImGui::ProgressBar(size > 0.0 ? static_cast<float>(used / size) : 0.0f, ImVec2(240.0f, 0.0f), text);
+    }
+    ImGui::Text("%u blocks, %u dedicated, %u allocations, %.0f%% fragmented", stats.memoryStats.blockCount,
+                stats.memoryStats.dedicatedAllocationCount, stats.memoryStats.allocationCount,
+                stats.memoryStats.fragmentation * 100.0f);
+
+    ImGui::End();
+    ImGui::Render();
+}
+
+VkCommandBuffer Overlay::record(uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance) {
+    if (!visible) {
+        return VK_NULL_HANDLE;
+    }
+
+    ImDrawData* drawData = ImGui::GetDrawData();
+    if (drawData == nullptr || drawData->TotalVtxCount == 0) {
+        return VK_NULL_HANDLE;
+    }
+
+    Frame& frame = frames[frameIndex];
+    vkResetCommandPool(device, frame.pool, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    if (vkBeginCommandBuffer(frame.commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording overlay command buffer");
+    }
+
+    // timestamps aren't allowed in the primary command buffer between secondaries, so the scope lives in here
+    uint32_t scope = profiler != nullptr ? profiler->beginScope(frame.commandBuffer, "overlay") : GpuProfiler::NO_SCOPE;
+
+    // vertices and indices go straight into the backend's persistently mapped buffers
+    ImGui_ImplVulkan_RenderDrawData(drawData, frame.commandBuffer);
+
+    if (profiler != nullptr) {
+        profiler->endScope(frame.commandBuffer, scope);
+    }
+
+    if (vkEndCommandBuffer(frame.commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record overlay command buffer");
+    }
+
+    return frame.commandBuffer;
+}
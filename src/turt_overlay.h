@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <GLFW/glfw3.h>
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_vulkan.h"
+#include "imgui/imgui_impl_glfw.h"
+
+#include "turt_allocator.h"
+#include "turt_culling.h"
+#include "turt_gpu_profiler.h"
+
+#include <cstdint>
+#include <vector>
+
+struct OverlayStats {
+    // milliseconds
+    double frameInterval = 0.0;
+    // from the end of the frame fence wait to the end of submit
+    double cpuTime = 0.0;
+    // negative when the gpu profiler is disabled
+    double gpuTime = -1.0;
+    uint32_t drawCount = 0;
+    uint64_t triangleCount = 0;
+    uint32_t objectCount = 0;
+    CullStats cullStats;
+    bool cpuCulling = false;
+    // bytes per second staged by the uploads flushed this frame
+    double uploadBandwidth = 0.0;
+    MemoryStats memoryStats;
+};
+
+// live stats drawn with dear imgui at the end of the main render pass
+// the ui is recorded into its own secondary command buffer, one per frame in flight
+class Overlay {
+public:
+    void init(GLFWwindow* window, VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice deviceIn,
+              uint32_t queueFamily, VkQueue queueIn, VkPipelineCache pipelineCache, VkRenderPass renderPass,
+              VkSampleCountFlagBits msaaSamples, uint32_t frameCountIn, GpuProfiler* profilerIn = nullptr);
+
+    void cleanup();
+
+    // the ui pipeline is compiled against the render pass, so it has to be rebuilt along with it
+    void setRenderPass(VkRenderPass renderPass);
+
+    void toggle() { visible = !visible; }
+
+    // builds this frame's ui, does nothing while hidden
+    void update(const OverlayStats& stats);
+
+    // VK_NULL_HANDLE while hidden, the gpu must be done with the last frame recorded for frameIndex
+    VkCommandBuffer record(uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance);
+
+private:
+    static constexpr uint32_t HISTORY_SIZE = 120;
+
+    struct Frame {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    // times the overlay's own draws, so its cost shows up next to everything else
+    GpuProfiler* profiler = nullptr;
+    ImGui_ImplVulkan_InitInfo initInfo{};
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    std::vector<Frame> frames;
+    bool visible = true;
+
+    // rings of the last HISTORY_SIZE frames, historyOffset is the oldest
+    float frameHistory[HISTORY_SIZE]{};
+    float gpuHistory[HISTORY_SIZE]{};
+    uint32_t historyOffset = 0;
+
+    void uploadFonts();
+};
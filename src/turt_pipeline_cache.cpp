@@ -0,0 +1,127 @@
+#include "turt_pipeline_cache.h"
+
+#include "turt_asset_cache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice deviceIn, const char* pathIn) {
+    device = deviceIn;
+    path = pathIn;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    expectedHeader.magic = PipelineCacheFileHeader::MAGIC;
+    expectedHeader.version = PipelineCacheFileHeader::VERSION;
+    expectedHeader.vendorID = properties.vendorID;
+    expectedHeader.deviceID = properties.deviceID;
+    expectedHeader.driverVersion = properties.driverVersion;
+    memcpy(expectedHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::string data;
+    loadedSize = load(data) ? data.size() : 0;
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = loadedSize;
+    cacheInfo.pInitialData = loadedSize > 0 ? data.data() : nullptr;
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache");
+    }
+}
+
+void PipelineCache::cleanup() {
+    // a cache that can't be written only costs the next startup some time
+    try {
+        save();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+
+    vkDestroyPipelineCache(device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::load(std::string& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    if (fileSize < sizeof(PipelineCacheFileHeader)) {
+        return false;
+    }
+
+    PipelineCacheFileHeader header;
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    // everything up to the data size has to match this device and driver exactly
+    if (!file || memcmp(&header, &expectedHeader, offsetof(PipelineCacheFileHeader, dataSize)) != 0 ||
+        header.dataSize != fileSize - sizeof(header)) {
+        return false;
+    }
+
+    data.resize(header.dataSize);
+    file.read(&data[0], data.size());
+    if (!file || hashBytes(data.data(), data.size()) != header.dataHash) {
+        return false;
+    }
+
+    // the driver's own header, which it checks again but a mismatch here means the file is bogus
+    VkPipelineCacheHeaderVersionOne driverHeader;
+    if (data.size() < sizeof(driverHeader)) {
+        return false;
+    }
+    memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+
+    return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           driverHeader.vendorID == expectedHeader.vendorID && driverHeader.deviceID == expectedHeader.deviceID &&
+           memcmp(driverHeader.pipelineCacheUUID, expectedHeader.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save() {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to get pipeline cache size");
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to get pipeline cache data");
+    }
+    data.resize(dataSize);
+
+    PipelineCacheFileHeader header = expectedHeader;
+    header.dataSize = dataSize;
+    header.dataHash = hashBytes(data.data(), data.size());
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to create pipeline cache file");
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), data.size());
+        if (!file) {
+            throw std::runtime_error("failed to write pipeline cache file");
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        throw std::runtime_error("failed to replace pipeline cache file");
+    }
+}
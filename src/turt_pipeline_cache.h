@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+// layout of the pipeline cache file: this header followed by the driver's cache data
+// the driver checks its own header too, this one also catches driver updates and truncated writes
+struct PipelineCacheFileHeader {
+    static constexpr uint32_t MAGIC = 0x43505054; // "TPPC"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint32_t padding;
+    uint64_t dataSize;
+    uint64_t dataHash;
+};
+
+// a VkPipelineCache that is loaded at startup and written back on cleanup
+// a file written for another device or driver is ignored and the cache starts out empty
+class PipelineCache {
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice deviceIn, const char* pathIn);
+
+    // writes to a temporary file first and renames it over the old one, so a crash never leaves a torn cache
+    void cleanup();
+
+    VkPipelineCache get() const { return cache; }
+
+    // whether usable data was found on disk
+    bool isWarm() const { return loadedSize > 0; }
+
+    size_t getLoadedSize() const { return loadedSize; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    std::string path;
+    PipelineCacheFileHeader expectedHeader{};
+    size_t loadedSize = 0;
+
+    bool load(std::string& data);
+
+    void save();
+};
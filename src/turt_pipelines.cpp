@@ -0,0 +1,297 @@
+#include "turt_pipelines.h"
+
+#include "turt_asset_cache.h"
+#include "turt_mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+size_t PipelineLibrary::KeyHash::operator()(const PipelineKey& key) const {
+    return static_cast<size_t>(hashBytes(&key, sizeof(key)));
+}
+
+bool PipelineLibrary::KeyEqual::operator()(const PipelineKey& a, const PipelineKey& b) const {
+    return memcmp(&a, &b, sizeof(PipelineKey)) == 0;
+}
+
+void PipelineLibrary::init(VkDevice deviceIn, VkPipelineCache cacheIn) {
+    device = deviceIn;
+    cache = cacheIn;
+
+    // a couple of threads is plenty, compiles are rare and shouldn't crowd out the frame's own jobs
+    compileJobs.init(std::max(1u, JobSystem::getDefaultWorkerCount() / 4));
+}
+
+void PipelineLibrary::cleanup() {
+    compileJobs.cleanup();
+
+    for (auto& entry : entries) {
+        if (entry.second.pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, entry.second.pipeline, nullptr);
+        }
+    }
+    entries.clear();
+
+    for (VkShaderModule shader : shaders) {
+        vkDestroyShaderModule(device, shader, nullptr);
+    }
+    shaders.clear();
+    shaderIds.clear();
+    stats = PipelineStats{};
+}
+
+uint32_t PipelineLibrary::loadShader(const char* path) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto existing = shaderIds.find(path);
+    if (existing != shaderIds.end()) {
+        return existing->second;
+    }
+
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file");
+    }
+
+    std::vector<char> code(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(code.data(), code.size());
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shader;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shader) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module");
+    }
+
+    uint32_t id = static_cast<uint32_t>(shaders.size());
+    shaders.push_back(shader);
+    shaderIds[path] = id;
+    return id;
+}
+
+VkPipeline PipelineLibrary::get(const PipelineKey& key, VkRenderPass renderPass, VkPipeline fallback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto existing = entries.find(key);
+        if (existing != entries.end()) {
+            if (existing->second.state == State::READY) {
+                return existing->second.pipeline;
+            }
+            stats.fallbackCount++;
+            return fallback;
+        }
+
+        entries[key] = Entry{};
+        stats.pendingCount++;
+        stats.fallbackCount++;
+    }
+
+    compileJobs.submit([this, key, renderPass]() {
+        try {
+            finish(key, createPipeline(key, renderPass), false);
+        } catch (const std::exception& e) {
+            // the fallback stays in use, so a broken variant shows up as a message rather than a crash
+            std::cerr << e.what() << std::endl;
+            finish(key, VK_NULL_HANDLE, true);
+        }
+    });
+
+    return fallback;
+}
+
+VkPipeline PipelineLibrary::compile(const PipelineKey& key, VkRenderPass renderPass) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        auto existing = entries.find(key);
+        if (existing != entries.end()) {
+            // elements stay put when the map rehashes, unlike iterators
+            Entry& entry = existing->second;
+            compiled.wait(lock, [&] { return entry.state != State::PENDING; });
+            if (entry.state == State::FAILED) {
+                throw std::runtime_error("failed to create graphics pipeline");
+            }
+            return entry.pipeline;
+        }
+
+        entries[key] = Entry{};
+        stats.pendingCount++;
+    }
+
+    VkPipeline pipeline;
+    try {
+        pipeline = createPipeline(key, renderPass);
+    } catch (...) {
+        finish(key, VK_NULL_HANDLE, true);
+        throw;
+    }
+
+    finish(key, pipeline, false);
+    return pipeline;
+}
+
+void PipelineLibrary::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    compiled.wait(lock, [this] { return stats.pendingCount == 0; });
+}
+
+PipelineStats PipelineLibrary::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void PipelineLibrary::finish(const PipelineKey& key, VkPipeline pipeline, bool failed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        Entry& entry = entries[key];
+        entry.pipeline = pipeline;
+        entry.state = failed ? State::FAILED : State::READY;
+
+        stats.pendingCount--;
+        if (failed) {
+            stats.failedCount++;
+        } else {
+            stats.compiledCount++;
+        }
+    }
+    compiled.notify_all();
+}
+
+VkPipeline PipelineLibrary::createPipeline(const PipelineKey& key, VkRenderPass renderPass) {
+    VkShaderModule vertexShader;
+    VkShaderModule fragmentShader;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        vertexShader = shaders[key.vertexShader];
+        fragmentShader = shaders[key.fragmentShader];
+    }
+
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertexShader;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragmentShader;
+    shaderStages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    auto bindingDescription = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    auto compactBindingDescription = CompactVertex::getBindingDescription();
+    auto compactAttributeDescriptions = CompactVertex::getAttributeDescriptions();
+
+    switch (key.vertexLayout) {
+    case VERTEX_LAYOUT_MESH:
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        break;
+    case VERTEX_LAYOUT_COMPACT:
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(compactAttributeDescriptions.size());
+        vertexInputInfo.pVertexBindingDescriptions = &compactBindingDescription;
+        vertexInputInfo.pVertexAttributeDescriptions = compactAttributeDescriptions.data();
+        break;
+    case VERTEX_LAYOUT_COUNT:
+        break;
+    }
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // viewport and scissor are dynamic, only the counts matter here
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = key.polygonMode;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = key.cullMode;
+    rasterizer.frontFace = key.frontFace;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = key.samples;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = key.depthTest;
+    depthStencil.depthWriteEnable = key.depthWrite;
+    depthStencil.depthCompareOp = key.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = key.blendMode != BLEND_MODE_OPAQUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor =
+        key.blendMode == BLEND_MODE_ADDITIVE ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = key.layout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = key.subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    // the pipeline cache is internally synchronized, so compiles on several threads can share it
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline");
+    }
+
+    return pipeline;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "turt_jobs.h"
+#include "turt_mesh.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+enum BlendMode : uint32_t {
+    BLEND_MODE_OPAQUE,
+    BLEND_MODE_ALPHA,
+    BLEND_MODE_ADDITIVE,
+};
+
+// everything a graphics pipeline is baked from
+// render passes are described by their formats and sample count, so pipelines survive render pass recreation
+// all members are 4 bytes except the layout, so there is no padding and the key can be hashed and compared as bytes
+struct PipelineKey {
+    VkPipelineLayout layout;
+    uint32_t vertexShader;
+    uint32_t fragmentShader;
+    VertexLayout vertexLayout;
+    BlendMode blendMode;
+    VkPolygonMode polygonMode;
+    VkCullModeFlags cullMode;
+    VkFrontFace frontFace;
+    VkBool32 depthTest;
+    VkBool32 depthWrite;
+    VkCompareOp depthCompareOp;
+    VkFormat colorFormat;
+    VkFormat depthFormat;
+    VkSampleCountFlagBits samples;
+    uint32_t subpass;
+};
+
+// a new member has to keep these, or the byte hash and compare start reading padding
+static_assert(sizeof(PipelineKey) == 64, "PipelineKey changed size, check it for padding");
+static_assert(std::has_unique_object_representations_v<PipelineKey>, "PipelineKey must not contain padding");
+
+struct PipelineStats {
+    uint32_t compiledCount = 0;
+    uint32_t pendingCount = 0;
+    uint32_t failedCount = 0;
+    // draws that went out with a fallback because their pipeline wasn't ready yet
+    uint64_t fallbackCount = 0;
+};
+
+// graphics pipelines by key, compiled on background threads the first time they're asked for
+// compiles run on a job system of their own, so the frame's parallelFor never picks one up and stalls on it
+class PipelineLibrary {
+public:
+    void init(VkDevice deviceIn, VkPipelineCache cacheIn);
+
+    // waits for pending compiles, then destroys every pipeline and shader module
+    void cleanup();
+
+    // shader modules are shared by path, the returned id goes into PipelineKey
+    uint32_t loadShader(const char* path);
+
+    // the pipeline for key if it's ready, otherwise fallback, queueing a compile against renderPass the first time
+    // renderPass has to stay alive until wait() returns
+    VkPipeline get(const PipelineKey& key, VkRenderPass renderPass, VkPipeline fallback);
+
+    // compiles on the calling thread, or waits for a compile that is already running
+    VkPipeline compile(const PipelineKey& key, VkRenderPass renderPass);
+
+    // blocks until no compile is running
+    void wait();
+
+    PipelineStats getStats();
+
+private:
+    enum class State {
+        PENDING,
+        READY,
+        FAILED,
+    };
+
+    struct Entry {
+        State state = State::PENDING;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    struct KeyHash {
+        size_t operator()(const PipelineKey& key) const;
+    };
+
+    struct KeyEqual {
+        bool operator()(const PipelineKey& a, const PipelineKey& b) const;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+
+    JobSystem compileJobs;
+
+    std::mutex mutex;
+    std::condition_variable compiled;
+    std::unordered_map<PipelineKey, Entry, KeyHash, KeyEqual> entries;
+    std::unordered_map<std::string, uint32_t> shaderIds;
+    std::vector<VkShaderModule> shaders;
+    PipelineStats stats;
+
+    VkPipeline createPipeline(const PipelineKey& key, VkRenderPass renderPass);
+
+    void finish(const PipelineKey& key, VkPipeline pipeline, bool failed);
+};
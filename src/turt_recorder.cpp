@@ -0,0 +1,99 @@
+#include "turt_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+void CommandRecorder::init(VkDevice deviceIn, uint32_t queueFamily, uint32_t frameCountIn, uint32_t chunkCountIn) {
+    device = deviceIn;
+    chunkCount = std::max(chunkCountIn, 1u);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = 1;
+
+    frames.resize(frameCountIn);
+    for (Frame& frame : frames) {
+        frame.pools.resize(chunkCount);
+        frame.commandBuffers.resize(chunkCount);
+
+        for (uint32_t i = 0; i < chunkCount; i++) {
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &frame.pools[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create recording command pool");
+            }
+
+            allocInfo.commandPool = frame.pools[i];
+            if (vkAllocateCommandBuffers(device, &allocInfo, &frame.commandBuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer");
+            }
+        }
+    }
+}
+
+void CommandRecorder::cleanup() {
+    for (Frame& frame : frames) {
+        for (VkCommandPool pool : frame.pools) {
+            vkDestroyCommandPool(device, pool, nullptr);
+        }
+    }
+    frames.clear();
+    recorded.clear();
+}
+
+void CommandRecorder::beginFrame(uint32_t frameIndex) {
+    currentFrame = frameIndex;
+
+    // resetting whole pools is cheaper than resetting their command buffers one by one
+    for (VkCommandPool pool : frames[currentFrame].pools) {
+        vkResetCommandPool(device, pool, 0);
+    }
+}
+
+const std::vector<VkCommandBuffer>& CommandRecorder::record(JobSystem& jobs,
+                                                            const VkCommandBufferInheritanceInfo& inheritance,
+                                                            uint32_t count,
+                                                            const std::function<void(VkCommandBuffer, uint32_t, uint32_t)>& func) {
+    Frame& frame = frames[currentFrame];
+
+    uint32_t usedChunks = std::min(chunkCount, (count + MIN_CHUNK_SIZE - 1) / MIN_CHUNK_SIZE);
+    usedChunks = std::max(usedChunks, 1u);
+    uint32_t chunkSize = (count + usedChunks - 1) / usedChunks;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    chunkStats.assign(usedChunks, RecordChunkStats{});
+
+    jobs.parallelFor(usedChunks, [&](uint32_t chunk) {
+        auto start = std::chrono::high_resolution_clock::now();
+        VkCommandBuffer commandBuffer = frame.commandBuffers[chunk];
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer");
+        }
+
+        uint32_t first = std::min(chunk * chunkSize, count);
+        uint32_t last = std::min(first + chunkSize, count);
+        func(commandBuffer, first, last);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer");
+        }
+
+        // every chunk writes only its own entry
+        chunkStats[chunk].itemCount = last - first;
+        chunkStats[chunk].recordTime =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    });
+
+    recorded.assign(frame.commandBuffers.begin(), frame.commandBuffers.begin() + usedChunks);
+    return recorded;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "turt_jobs.h"
+
+#include <functional>
+#include <vector>
+
+// what one chunk of the last record call covered and how long its thread took to record it
+struct RecordChunkStats {
+    uint32_t itemCount = 0;
+    // milliseconds
+    double recordTime = 0.0;
+};
+
+// records secondary command buffers on the job system
+// every chunk of the work gets its own command pool per frame in flight, so no pool is touched by two threads
+class CommandRecorder {
+public:
+    void init(VkDevice deviceIn, uint32_t queueFamily, uint32_t frameCountIn, uint32_t chunkCountIn);
+
+    void cleanup();
+
+    // resets the frame's pools, the gpu must be done with everything recorded for this frame index before
+    void beginFrame(uint32_t frameIndex);
+
+    // splits [0, count) into chunks and calls func(commandBuffer, first, last) for each one in parallel
+    // the returned secondary command buffers continue the render pass in inheritance and keep the order of the chunks
+    const std::vector<VkCommandBuffer>& record(JobSystem& jobs, const VkCommandBufferInheritanceInfo& inheritance,
+                                               uint32_t count,
+                                               const std::function<void(VkCommandBuffer, uint32_t, uint32_t)>& func);
+
+    const std::vector<RecordChunkStats>& getChunkStats() const { return chunkStats; }
+
+private:
+    struct Frame {
+        std::vector<VkCommandPool> pools;
+        std::vector<VkCommandBuffer> commandBuffers;
+    };
+
+    // below this many items per chunk, the cost of another command buffer outweighs the parallelism
+    static constexpr uint32_t MIN_CHUNK_SIZE = 256;
+
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t chunkCount = 0;
+
+    std::vector<Frame> frames;
+    uint32_t currentFrame = 0;
+
+    std::vector<VkCommandBuffer> recorded;
+    std::vector<RecordChunkStats> chunkStats;
+};
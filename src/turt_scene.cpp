@@ -0,0 +1,227 @@
+#include "turt_scene.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TURT_SCENE_SSE
+#include <emmintrin.h>
+#endif
+
+// out = a * b, with the same operation order as glm so both paths agree exactly
+static void multiplyTransforms(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) {
+#if defined(TURT_SCENE_SSE)
+    const float* left = &a[0][0];
+    const float* right = &b[0][0];
+    float* result = &out[0][0];
+
+    __m128 column0 = _mm_loadu_ps(left);
+    __m128 column1 = _mm_loadu_ps(left + 4);
+    __m128 column2 = _mm_loadu_ps(left + 8);
+    __m128 column3 = _mm_loadu_ps(left + 12);
+
+    for (int i = 0; i < 4; i++) {
+        __m128 sum = _mm_mul_ps(column0, _mm_set1_ps(right[i * 4]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column1, _mm_set1_ps(right[i * 4 + 1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column2, _mm_set1_ps(right[i * 4 + 2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(column3, _mm_set1_ps(right[i * 4 + 3])));
+        _mm_storeu_ps(result + i * 4, sum);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+uint32_t Scene::create(uint32_t mesh, uint32_t texture, const glm::vec4& boundingSphere,
+                       const glm::mat4& localTransform, UpdateFunc update, uint32_t parent) {
+    uint32_t handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = static_cast<uint32_t>(handleToIndex.size());
+        handleToIndex.push_back(0);
+    }
+
+    uint32_t index = getCount();
+    handleToIndex[handle] = index;
+    indexToHandle.push_back(handle);
+
+    models.push_back(localTransform);
+    localTransforms.push_back(localTransform);
+    parents.push_back(parent == NO_PARENT ? NO_PARENT : handleToIndex[parent]);
+    dirty.push_back(0);
+    markDirty(index);
+    boundingSpheres.push_back(boundingSphere);
+    meshes.push_back(mesh);
+    textures.push_back(texture);
+
+    if (update != nullptr) {
+        updatedObjects.push_back(handle);
+        updates.push_back(update);
+    }
+
+    drawOrderDirty = true;
+    return handle;
+}
+
+void Scene::destroy(uint32_t handle) {
+    uint32_t index = handleToIndex[handle];
+    uint32_t parent = parents[index];
+
+    // children move up to the grandparent and keep their world transform
+    bool reparented = false;
+    for (uint32_t i = index + 1; i < getCount(); i++) {
+        if (parents[i] == index) {
+            localTransforms[i] = localTransforms[index] * localTransforms[i];
+            parents[i] = parent;
+            dirty[i] = 1;
+            reparented = true;
+        }
+    }
+
+    // erase rather than swap with the last object, which would break the parent ordering
+    models.erase(models.begin() + index);
+    localTransforms.erase(localTransforms.begin() + index);
+    parents.erase(parents.begin() + index);
+    dirty.erase(dirty.begin() + index);
+    boundingSpheres.erase(boundingSpheres.begin() + index);
+    meshes.erase(meshes.begin() + index);
+    textures.erase(textures.begin() + index);
+    indexToHandle.erase(indexToHandle.begin() + index);
+
+    for (uint32_t i = index; i < getCount(); i++) {
+        if (parents[i] != NO_PARENT && parents[i] > index) {
+            parents[i]--;
+        }
+        handleToIndex[indexToHandle[i]] = i;
+    }
+    if (reparented || firstDirty != UINT32_MAX) {
+        firstDirty = std::min(firstDirty, index);
+    }
+
+    auto updated = std::find(updatedObjects.begin(), updatedObjects.end(), handle);
+    if (updated != updatedObjects.end()) {
+        size_t i = updated - updatedObjects.begin();
+        updatedObjects.erase(updated);
+        updates.erase(updates.begin() + i);
+    }
+
+    freeHandles.push_back(handle);
+    drawOrderDirty = true;
+}
+
+void Scene::clear() {
+    models.clear();
+    localTransforms.clear();
+    parents.clear();
+    dirty.clear();
+    firstDirty = UINT32_MAX;
+    boundingSpheres.clear();
+    meshes.clear();
+    textures.clear();
+    updatedObjects.clear();
+    updates.clear();
+    handleToIndex.clear();
+    indexToHandle.clear();
+    freeHandles.clear();
+    drawOrder.clear();
+    drawBatches.clear();
+    drawOrderDirty = false;
+}
+
+void Scene::setLocalTransform(uint32_t handle, const glm::mat4& localTransform) {
+    uint32_t index = handleToIndex[handle];
+    localTransforms[index] = localTransform;
+    markDirty(index);
+}
+
+void Scene::markDirty(uint32_t index) {
+    dirty[index] = 1;
+    firstDirty = std::min(firstDirty, index);
+}
+
+void Scene::update(double time) {
+    for (size_t i = 0; i < updates.size(); i++) {
+        uint32_t index = handleToIndex[updatedObjects[i]];
+        updates[i](localTransforms[index], time);
+        markDirty(index);
+    }
+
+    updateTransforms();
+}
+
+void Scene::updateTransforms() {
+    uint32_t count = getCount();
+    if (firstDirty >= count) {
+        return;
+    }
+
+    // a parent's flag is final by the time its children are reached, so dirtiness flows down in the same pass
+    for (uint32_t i = firstDirty; i < count; i++) {
+        uint32_t parent = parents[i];
+        if (parent != NO_PARENT && dirty[parent]) {
+            dirty[i] = 1;
+        }
+        if (!dirty[i]) {
+            continue;
+        }
+
+        if (parent == NO_PARENT) {
+            models[i] = localTransforms[i];
+        } else {
+            multiplyTransforms(models[parent], localTransforms[i], models[i]);
+        }
+    }
+
+    std::fill(dirty.begin() + firstDirty, dirty.end(), 0);
+    firstDirty = UINT32_MAX;
+}
+
+void Scene::computeWorldSpheres(SphereArrays& spheres, JobSystem& jobs) const {
+    const uint32_t chunkSize = 4096;
+
+    uint32_t count = getCount();
+    spheres.resize(count);
+    jobs.parallelFor((count + chunkSize - 1) / chunkSize, [&](uint32_t chunk) {
+        uint32_t last = std::min((chunk + 1) * chunkSize, count);
+        for (uint32_t i = chunk * chunkSize; i < last; i++) {
+            spheres.set(i, transformSphere(boundingSpheres[i], models[i]));
+        }
+    });
+}
+
+const std::vector<uint32_t>& Scene::getDrawOrder() {
+    if (drawOrderDirty) {
+        buildDrawOrder();
+    }
+    return drawOrder;
+}
+
+const std::vector<DrawBatch>& Scene::getDrawBatches() {
+    if (drawOrderDirty) {
+        buildDrawOrder();
+    }
+    return drawBatches;
+}
+
+void Scene::buildDrawOrder() {
+    drawOrder.resize(getCount());
+    for (uint32_t i = 0; i < drawOrder.size(); i++) {
+        drawOrder[i] = i;
+    }
+    // by texture for the batches, then by mesh so copies of a mesh can be drawn instanced
+    std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](uint32_t a, uint32_t b) {
+        return textures[a] != textures[b] ? textures[a] < textures[b] : meshes[a] < meshes[b];
+    });
+
+    drawBatches.clear();
+    for (uint32_t i = 0; i < drawOrder.size(); i++) {
+        uint32_t texture = textures[drawOrder[i]];
+        if (drawBatches.empty() || drawBatches.back().texture != texture) {
+            drawBatches.push_back({ texture, i, 0 });
+        }
+        drawBatches.back().drawCount++;
+    }
+
+    drawOrderDirty = false;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "turt_culling.h"
+#include "turt_jobs.h"
+
+#include <cstdint>
+#include <vector>
+
+// writes the object's transform relative to its parent, time is in seconds since the animation started
+typedef void (*UpdateFunc)(glm::mat4& localTransform, double time);
+
+// a run of objects sharing a texture, drawn with one indirect call
+struct DrawBatch {
+    uint32_t texture;
+    uint32_t firstDraw;
+    uint32_t drawCount;
+};
+
+// objects stored one array per field, so per-frame passes only touch the fields they use
+// handles stay valid while the dense arrays are compacted by destroy()
+// parents always sit before their children, so world transforms resolve in one pass from front to back
+class Scene {
+public:
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    // children are appended after everything else, which keeps them behind their parent
+    uint32_t create(uint32_t mesh, uint32_t texture, const glm::vec4& boundingSphere, const glm::mat4& localTransform,
+                    UpdateFunc update, uint32_t parent = NO_PARENT);
+
+    void destroy(uint32_t handle);
+
+    void clear();
+
+    uint32_t getCount() const { return static_cast<uint32_t>(models.size()); }
+
+    uint32_t getIndex(uint32_t handle) const { return handleToIndex[handle]; }
+
+    // runs the update callbacks of the objects that have one at time, then updateTransforms()
+    void update(double time);
+
+    // recomputes the world transforms of moved objects and everything below them
+    void updateTransforms();
+
+    // local bounding spheres moved into world space by each object's model matrix
+    void computeWorldSpheres(SphereArrays& spheres, JobSystem& jobs) const;
+
+    // dense indices grouped by texture and then mesh, and the per-texture batches over them
+    const std::vector<uint32_t>& getDrawOrder();
+
+    const std::vector<DrawBatch>& getDrawBatches();
+
+    // world transforms, current as of the last updateTransforms()
+    const std::vector<glm::mat4>& getModels() const { return models; }
+
+    const std::vector<uint32_t>& getMeshes() const { return meshes; }
+
+    const std::vector<uint32_t>& getTextures() const { return textures; }
+
+    void setLocalTransform(uint32_t handle, const glm::mat4& localTransform);
+
+private:
+    // hot, read every frame
+    std::vector<glm::mat4> models;
+    std::vector<glm::mat4> localTransforms;
+    // dense index of the parent, always lower than the object's own
+    std::vector<uint32_t> parents;
+    std::vector<uint8_t> dirty;
+    // lowest dirty index, nothing before it needs a look
+    uint32_t firstDirty = UINT32_MAX;
+    std::vector<glm::vec4> boundingSpheres;
+    std::vector<uint32_t> meshes;
+    std::vector<uint32_t> textures;
+
+    // only objects with a callback are listed, by handle
+    std::vector<uint32_t> updatedObjects;
+    std::vector<UpdateFunc> updates;
+
+    std::vector<uint32_t> handleToIndex;
+    std::vector<uint32_t> indexToHandle;
+    std::vector<uint32_t> freeHandles;
+
+    std::vector<uint32_t> drawOrder;
+    std::vector<DrawBatch> drawBatches;
+    bool drawOrderDirty = false;
+
+    void markDirty(uint32_t index);
+
+    void buildDrawOrder();
+};
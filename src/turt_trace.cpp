@@ -0,0 +1,190 @@
+#include "turt_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// a thread only ever appends to its own buffer, the mutex is only taken the first time a thread records
+struct TraceBuffer {
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    // chunks never move once allocated, so growing never copies events
+    std::vector<std::unique_ptr<TraceEvent[]>> chunks;
+    size_t count = 0;
+    uint32_t threadIndex = 0;
+};
+
+static std::atomic<bool> tracing{ false };
+static uint64_t traceStart = 0;
+static std::vector<uint64_t> frameStarts;
+
+// owned here rather than by the threads, so events outlive workers that exit before the trace is written
+static std::mutex buffersMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static thread_local TraceBuffer* threadBuffer = nullptr;
+
+uint64_t getTraceTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void beginTrace() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (std::unique_ptr<TraceBuffer>& buffer : buffers) {
+        buffer->count = 0;
+    }
+    frameStarts.clear();
+    traceStart = getTraceTime();
+    tracing.store(true, std::memory_order_release);
+}
+
+void endTrace() {
+    tracing.store(false, std::memory_order_release);
+}
+
+bool isTracing() {
+    return tracing.load(std::memory_order_relaxed);
+}
+
+void markTraceFrame() {
+    if (isTracing()) {
+        frameStarts.push_back(getTraceTime());
+    }
+}
+
+void recordTraceEvent(const char* name, uint64_t start, uint64_t end) {
+    TraceBuffer* buffer = threadBuffer;
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(std::make_unique<TraceBuffer>());
+        buffer = buffers.back().get();
+        buffer->threadIndex = static_cast<uint32_t>(buffers.size() - 1);
+        threadBuffer = buffer;
+    }
+
+    size_t chunk = buffer->count / TraceBuffer::CHUNK_SIZE;
+    if (chunk == buffer->chunks.size()) {
+        buffer->chunks.emplace_back(new TraceEvent[TraceBuffer::CHUNK_SIZE]);
+    }
+    buffer->chunks[chunk][buffer->count % TraceBuffer::CHUNK_SIZE] = { name, start, end };
+    buffer->count++;
+}
+
+template<typename Func>
+static void forEachTraceEvent(Func func) {
+    for (const std::unique_ptr<TraceBuffer>& buffer : buffers) {
+        for (size_t i = 0; i < buffer->count; i++) {
+            func(*buffer, buffer->chunks[i / TraceBuffer::CHUNK_SIZE][i % TraceBuffer::CHUNK_SIZE]);
+        }
+    }
+}
+
+// chrome wants microseconds, the fraction keeps the nanoseconds
+static void writeTraceTime(std::ofstream& file, uint64_t nanoseconds) {
+    char text[32];
+    snprintf(text, sizeof(text), "%llu.%03llu", static_cast<unsigned long long>(nanoseconds / 1000),
+             static_cast<unsigned long long>(nanoseconds % 1000));
+    file << text;
+}
+
+void writeTrace(const char* path) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open trace file");
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    bool first = true;
+    for (const std::unique_ptr<TraceBuffer>& buffer : buffers) {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadIndex
+             << ",\"args\":{\"name\":\"thread " << buffer->threadIndex << "\"}}";
+        first = false;
+    }
+
+    forEachTraceEvent([&](const TraceBuffer& buffer, const TraceEvent& event) {
+        file << (first ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+             << buffer.threadIndex << ",\"ts\":";
+        writeTraceTime(file, event.start - traceStart);
+        file << ",\"dur\":";
+        writeTraceTime(file, event.end - event.start);
+        file << "}";
+        first = false;
+    });
+
+    for (uint64_t frameStart : frameStarts) {
+        file << (first ? "" : ",\n") << "{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":";
+        writeTraceTime(file, frameStart - traceStart);
+        file << "}";
+        first = false;
+    }
+
+    file << "\n]}\n";
+}
+
+void printTraceSummary() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    if (frameStarts.size() < 2) {
+        std::cout << "trace: fewer than two frames, no summary" << std::endl;
+        return;
+    }
+
+    // the last mark only closes the frame before it
+    size_t frameCount = frameStarts.size() - 1;
+
+    struct ZoneSummary {
+        uint64_t calls = 0;
+        std::vector<double> frameTimes;
+    };
+    std::map<std::string, ZoneSummary> zones;
+    size_t eventCount = 0;
+
+    forEachTraceEvent([&](const TraceBuffer&, const TraceEvent& event) {
+        eventCount++;
+        auto next = std::upper_bound(frameStarts.begin(), frameStarts.end(), event.start);
+        if (next == frameStarts.begin() || next == frameStarts.end()) {
+            return;
+        }
+
+        ZoneSummary& zone = zones[event.name];
+        if (zone.frameTimes.empty()) {
+            zone.frameTimes.resize(frameCount);
+        }
+        zone.calls++;
+        zone.frameTimes[next - frameStarts.begin() - 1] += (event.end - event.start) / 1000000.0;
+    });
+
+    double totalTime = (frameStarts.back() - frameStarts.front()) / 1000000.0;
+    std::cout << "trace: " << frameCount << " frames, " << totalTime / frameCount << " ms average, " << eventCount
+              << " events" << std::endl;
+
+    std::vector<std::pair<double, std::string>> lines;
+    for (const auto& [name, zone] : zones) {
+        double total = 0.0;
+        double worst = 0.0;
+        for (double time : zone.frameTimes) {
+            total += time;
+            worst = std::max(worst, time);
+        }
+
+        char text[256];
+        snprintf(text, sizeof(text), "  %-24s %8.2f calls %10.4f ms average %10.4f ms worst", name.c_str(),
+                 static_cast<double>(zone.calls) / frameCount, total / frameCount, worst);
+        lines.emplace_back(total, text);
+    }
+
+    // most expensive first, times are per frame and include nested zones
+    std::sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (const auto& line : lines) {
+        std::cout << line.second << std::endl;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+// cpu zones recorded into per-thread buffers, exported as chrome trace events (chrome://tracing, perfetto)
+// zones only exist when built with TURT_TRACE, without it the macros below compile to nothing
+
+struct TraceEvent {
+    const char* name;
+    // from getTraceTime
+    uint64_t start;
+    uint64_t end;
+};
+
+// nanoseconds on a steady clock
+uint64_t getTraceTime();
+
+// clears anything recorded before and starts recording
+void beginTrace();
+
+// stops recording, zones still open are dropped
+void endTrace();
+
+bool isTracing();
+
+// splits the trace into frames for the summary
+void markTraceFrame();
+
+// the trace has to be ended and every traced thread idle before reading it back
+void writeTrace(const char* path);
+
+// per zone: calls, average and worst time per frame
+void printTraceSummary();
+
+void recordTraceEvent(const char* name, uint64_t start, uint64_t end);
+
+struct TraceZone {
+    const char* name;
+    uint64_t start;
+
+    explicit TraceZone(const char* nameIn) : name(nameIn), start(isTracing() ? getTraceTime() : 0) {}
+
+    ~TraceZone() {
+        if (start != 0 && isTracing()) {
+            recordTraceEvent(name, start, getTraceTime());
+        }
+    }
+};
+
+#define TURT_TRACE_CONCAT_INNER(a, b) a##b
+#define TURT_TRACE_CONCAT(a, b) TURT_TRACE_CONCAT_INNER(a, b)
+
+#if defined(TURT_TRACE)
+#define TURT_TRACE_ZONE(name) TraceZone TURT_TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TURT_TRACE_FRAME() markTraceFrame()
+#else
+#define TURT_TRACE_ZONE(name)
+#define TURT_TRACE_FRAME()
+#endif
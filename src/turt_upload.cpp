@@ -0,0 +1,433 @@
+#include "turt_upload.h"
+
+#include <cstring>
+#include <stdexcept>
+
+void UploadManager::init(VkDevice deviceIn, MemoryAllocator* allocatorIn, uint32_t graphicsFamilyIn,
+                         VkQueue graphicsQueueIn, uint32_t transferFamilyIn, VkQueue transferQueueIn,
+                         VkDeviceSize stagingRingSizeIn, GpuProfiler* profilerIn) {
+    device = deviceIn;
+    allocator = allocatorIn;
+    graphicsFamily = graphicsFamilyIn;
+    graphicsQueue = graphicsQueueIn;
+    transferFamily = transferFamilyIn;
+    transferQueue = transferQueueIn;
+    profiler = profilerIn != nullptr && profilerIn->isSupported(transferFamily) ? profilerIn : nullptr;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    poolInfo.queueFamilyIndex = transferFamily;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool");
+    }
+
+    if (hasDedicatedTransferQueue()) {
+        poolInfo.queueFamilyIndex = graphicsFamily;
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &graphicsCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload command pool");
+        }
+    }
+
+    stagingRingSize = stagingRingSizeIn;
+    stagingRing = createStagingBuffer(stagingRingSize, stagingRingAllocation);
+    ringHead = 0;
+    ringTail = 0;
+}
+
+void UploadManager::cleanup() {
+    wait(flush());
+
+    for (Batch& batch : freeBatches) {
+        destroyBatch(batch);
+    }
+    freeBatches.clear();
+
+    if (graphicsCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(device, graphicsCommandPool, nullptr);
+        graphicsCommandPool = VK_NULL_HANDLE;
+    }
+    vkDestroyCommandPool(device, transferCommandPool, nullptr);
+
+    vkDestroyBuffer(device, stagingRing, nullptr);
+    allocator->free(stagingRingAllocation);
+}
+
+UploadManager::Batch UploadManager::createBatch() {
+    Batch batch;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    allocInfo.commandPool = transferCommandPool;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &batch.transferCommands) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer");
+    }
+
+    if (hasDedicatedTransferQueue()) {
+        allocInfo.commandPool = graphicsCommandPool;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &batch.graphicsCommands) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer");
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch.transferComplete) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload semaphore");
+        }
+    } else {
+        batch.graphicsCommands = batch.transferCommands;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload fence");
+    }
+
+    return batch;
+}
+
+void UploadManager::destroyBatch(Batch& batch) {
+    releaseStaging(batch);
+
+    vkDestroyFence(device, batch.fence, nullptr);
+    if (batch.transferComplete != VK_NULL_HANDLE) {
+        vkDestroySemaphore(device, batch.transferComplete, nullptr);
+    }
+    // command buffers go with their pools
+}
+
+void UploadManager::releaseStaging(Batch& batch) {
+    for (size_t i = 0; i < batch.stagingBuffers.size(); i++) {
+        vkDestroyBuffer(device, batch.stagingBuffers[i], nullptr);
+        allocator->free(batch.stagingAllocations[i]);
+    }
+    batch.stagingBuffers.clear();
+    batch.stagingAllocations.clear();
+}
+
+UploadManager::Batch& UploadManager::getCurrentBatch() {
+    if (recording) {
+        return current;
+    }
+
+    if (!freeBatches.empty()) {
+        current = std::move(freeBatches.back());
+        freeBatches.pop_back();
+    } else {
+        current = createBatch();
+    }
+    current.id = nextBatchId++;
+    current.ringEnd = ringHead;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(current.transferCommands, &beginInfo);
+    if (hasDedicatedTransferQueue()) {
+        vkBeginCommandBuffer(current.graphicsCommands, &beginInfo);
+    }
+
+    current.profilerScope = profiler != nullptr ? profiler->beginScope(current.transferCommands, "upload")
+                                                : GpuProfiler::NO_SCOPE;
+
+    recording = true;
+    return current;
+}
+
+VkBuffer UploadManager::createStagingBuffer(VkDeviceSize size, Allocation& allocation) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create staging buffer");
+    }
+
+    allocation = allocator->allocateBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           false);
+    return buffer;
+}
+
+bool UploadManager::reserveRing(VkDeviceSize size, uint64_t& position) {
+    position = (ringHead + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+    // an upload never straddles the end of the ring, skip ahead to the start instead
+    if (position % stagingRingSize + size > stagingRingSize) {
+        position = (position / stagingRingSize + 1) * stagingRingSize;
+    }
+
+    return position + size - ringTail <= stagingRingSize;
+}
+
+UploadManager::Batch& UploadManager::stage(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset) {
+    stats.bytesStaged += size;
+    stats.totalBytesStaged += size;
+
+    if (size > stagingRingSize) {
+        stats.oversizedCount++;
+
+        Batch& batch = getCurrentBatch();
+        Allocation allocation;
+        buffer = createStagingBuffer(size, allocation);
+        offset = 0;
+        memcpy(allocation.mapped, data, static_cast<size_t>(size));
+
+        batch.stagingBuffers.push_back(buffer);
+        batch.stagingAllocations.push_back(allocation);
+        return batch;
+    }
+
+    uint64_t position;
+    if (!reserveRing(size, position)) {
+        stats.stallCount++;
+
+        // the space may be held by the batch still being recorded
+        flush();
+        while (!reserveRing(size, position)) {
+            if (pendingBatches.empty()) {
+                // nothing is in flight, so the wrap padding can be dropped by starting over
+                ringHead = 0;
+                ringTail = 0;
+                continue;
+            }
+            vkWaitForFences(device, 1, &pendingBatches.front().fence, VK_TRUE, UINT64_MAX);
+            collect();
+        }
+    }
+
+    Batch& batch = getCurrentBatch();
+    ringHead = position + size;
+    batch.ringEnd = ringHead;
+
+    buffer = stagingRing;
+    offset = position % stagingRingSize;
+    memcpy(static_cast<char*>(stagingRingAllocation.mapped) + offset, data, static_cast<size_t>(size));
+    return batch;
+}
+
+void UploadManager::uploadBuffer(VkBuffer buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                                 VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+    VkBuffer stagingBuffer;
+    VkDeviceSize stagingOffset;
+    Batch& batch = stage(data, size, stagingBuffer, stagingOffset);
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = stagingOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(batch.transferCommands, stagingBuffer, buffer, 1, &copyRegion);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = buffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    if (!hasDedicatedTransferQueue()) {
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+        vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1,
+                             &barrier, 0, nullptr);
+        return;
+    }
+
+    // release from the transfer queue, then acquire on the graphics queue
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(batch.graphicsCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStage, 0, 0, nullptr, 1, &barrier,
+                         0, nullptr);
+}
+
+void UploadManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkPipelineStageFlags dstStage,
+                               VkAccessFlags dstAccess) {
+    Batch& batch = getCurrentBatch();
+
+    // the source was last written by an upload and acquired on the graphics queue
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(batch.graphicsCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                         &memoryBarrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = size;
+    vkCmdCopyBuffer(batch.graphicsCommands, srcBuffer, dstBuffer, 1, &copyRegion);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = dstBuffer;
+    barrier.offset = 0;
+    barrier.size = size;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    vkCmdPipelineBarrier(batch.graphicsCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0,
+                         nullptr);
+}
+
+VkCommandBuffer UploadManager::uploadImage(VkImage image, const void* data, VkDeviceSize size, uint32_t width,
+                                           uint32_t height, uint32_t mipLevels) {
+    VkBuffer stagingBuffer;
+    VkDeviceSize stagingOffset;
+    Batch& batch = stage(data, size, stagingBuffer, stagingOffset);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = stagingOffset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { width, height, 1 };
+
+    vkCmdCopyBufferToImage(batch.transferCommands, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    if (hasDedicatedTransferQueue()) {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = transferFamily;
+        barrier.dstQueueFamilyIndex = graphicsFamily;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(batch.graphicsCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    return batch.graphicsCommands;
+}
+
+uint64_t UploadManager::flush() {
+    if (!recording) {
+        return nextBatchId - 1;
+    }
+    recording = false;
+
+    if (profiler != nullptr) {
+        profiler->endScope(current.transferCommands, current.profilerScope);
+    }
+    vkEndCommandBuffer(current.transferCommands);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &current.transferCommands;
+
+    if (!hasDedicatedTransferQueue()) {
+        if (vkQueueSubmit(transferQueue, 1, &submitInfo, current.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload batch");
+        }
+    } else {
+        vkEndCommandBuffer(current.graphicsCommands);
+
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &current.transferComplete;
+        if (vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload batch");
+        }
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        VkSubmitInfo acquireInfo{};
+        acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireInfo.waitSemaphoreCount = 1;
+        acquireInfo.pWaitSemaphores = &current.transferComplete;
+        acquireInfo.pWaitDstStageMask = &waitStage;
+        acquireInfo.commandBufferCount = 1;
+        acquireInfo.pCommandBuffers = &current.graphicsCommands;
+
+        if (vkQueueSubmit(graphicsQueue, 1, &acquireInfo, current.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload batch");
+        }
+    }
+
+    uint64_t id = current.id;
+    pendingBatches.push_back(std::move(current));
+    current = Batch{};
+    return id;
+}
+
+void UploadManager::collect() {
+    while (!pendingBatches.empty() && vkGetFenceStatus(device, pendingBatches.front().fence) == VK_SUCCESS) {
+        Batch batch = std::move(pendingBatches.front());
+        pendingBatches.pop_front();
+
+        releaseStaging(batch);
+        vkResetFences(device, 1, &batch.fence);
+        vkResetCommandBuffer(batch.transferCommands, 0);
+        if (hasDedicatedTransferQueue()) {
+            vkResetCommandBuffer(batch.graphicsCommands, 0);
+        }
+
+        completedBatchId = batch.id;
+        ringTail = batch.ringEnd;
+        freeBatches.push_back(std::move(batch));
+    }
+}
+
+void UploadManager::beginFrame() {
+    flush();
+    collect();
+
+    stats.lastFrameBytesStaged = stats.bytesStaged;
+    stats.bytesStaged = 0;
+}
+
+bool UploadManager::isComplete(uint64_t batchId) {
+    collect();
+    return batchId <= completedBatchId;
+}
+
+void UploadManager::wait(uint64_t batchId) {
+    if (recording && batchId >= current.id) {
+        flush();
+    }
+
+    while (batchId > completedBatchId && !pendingBatches.empty()) {
+        vkWaitForFences(device, 1, &pendingBatches.front().fence, VK_TRUE, UINT64_MAX);
+        collect();
+    }
+}
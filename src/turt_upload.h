@@ -0,0 +1,123 @@
+#pragma once
+
+#include "turt_allocator.h"
+#include "turt_gpu_profiler.h"
+
+#include <deque>
+#include <vector>
+
+struct UploadStats {
+    uint64_t bytesStaged = 0;
+    uint64_t lastFrameBytesStaged = 0;
+    uint64_t totalBytesStaged = 0;
+    // uploads that had to wait for the gpu to free up ring space
+    uint32_t stallCount = 0;
+    // uploads too large for the ring that got a buffer of their own
+    uint32_t oversizedCount = 0;
+};
+
+// batches staging copies into one command buffer per batch on the transfer queue
+// nothing waits on the gpu here: resources are safe to use from any graphics submission made after flush()
+class UploadManager {
+public:
+    void init(VkDevice deviceIn, MemoryAllocator* allocatorIn, uint32_t graphicsFamilyIn, VkQueue graphicsQueueIn,
+              uint32_t transferFamilyIn, VkQueue transferQueueIn, VkDeviceSize stagingRingSizeIn,
+              GpuProfiler* profilerIn = nullptr);
+
+    void cleanup();
+
+    void uploadBuffer(VkBuffer buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+                      VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    // copies between two buffers the graphics queue owns, like a resource being moved into a larger one
+    // recorded into the batch's graphics commands, so it runs after the batch's transfers
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkPipelineStageFlags dstStage,
+                    VkAccessFlags dstAccess);
+
+    // copies mip level 0 and leaves every level in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, owned by the graphics queue
+    // the returned command buffer runs on the graphics queue after the copy, for follow-up work like mipmap generation
+    VkCommandBuffer uploadImage(VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height,
+                                uint32_t mipLevels);
+
+    // submits everything recorded since the last flush and returns its batch id, or the last id if nothing was recorded
+    uint64_t flush();
+
+    // recycles batches the gpu has finished with
+    void collect();
+
+    // once per frame ahead of rendering: flushes, collects and rolls the per-frame counters
+    void beginFrame();
+
+    // the batch anything recorded so far goes out in, which may not have been submitted yet
+    uint64_t getRecordedBatchId() const { return recording ? current.id : nextBatchId - 1; }
+
+    bool isComplete(uint64_t batchId);
+
+    void wait(uint64_t batchId);
+
+    bool hasDedicatedTransferQueue() const { return transferFamily != graphicsFamily; }
+
+    const UploadStats& getStats() const { return stats; }
+
+private:
+    struct Batch {
+        uint64_t id = 0;
+        VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+        VkCommandBuffer graphicsCommands = VK_NULL_HANDLE;
+        VkSemaphore transferComplete = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        uint32_t profilerScope = GpuProfiler::NO_SCOPE;
+        // ring position up to which this batch's staging data extends
+        uint64_t ringEnd = 0;
+        std::vector<VkBuffer> stagingBuffers;
+        std::vector<Allocation> stagingAllocations;
+    };
+
+    static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+
+    uint32_t graphicsFamily = 0;
+    VkQueue graphicsQueue = VK_NULL_HANDLE;
+    VkCommandPool graphicsCommandPool = VK_NULL_HANDLE;
+
+    uint32_t transferFamily = 0;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+
+    Batch current;
+    bool recording = false;
+
+    std::deque<Batch> pendingBatches;
+    std::vector<Batch> freeBatches;
+
+    uint64_t nextBatchId = 1;
+    uint64_t completedBatchId = 0;
+
+    // ring positions only ever grow, the physical offset is position % ringSize
+    VkBuffer stagingRing = VK_NULL_HANDLE;
+    Allocation stagingRingAllocation;
+    VkDeviceSize stagingRingSize = 0;
+    uint64_t ringHead = 0;
+    uint64_t ringTail = 0;
+
+    UploadStats stats;
+
+    // times each batch's transfer commands, when the transfer family can write timestamps
+    GpuProfiler* profiler = nullptr;
+
+    Batch& getCurrentBatch();
+
+    Batch createBatch();
+
+    void destroyBatch(Batch& batch);
+
+    void releaseStaging(Batch& batch);
+
+    VkBuffer createStagingBuffer(VkDeviceSize size, Allocation& allocation);
+
+    bool reserveRing(VkDeviceSize size, uint64_t& position);
+
+    Batch& stage(const void* data, VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+};